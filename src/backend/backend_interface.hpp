@@ -6,7 +6,12 @@
 
 class BackendInterface {
     public:
-        virtual void dump(SSSPMetrics *metrics, unsigned long long sourceNode) = 0;
+        // Stores a batch of rounds, called from the writer thread of SSSPMetrics only
+        virtual void dump(std::vector<MetricsSnapshot> &batch) = 0;
+        // Whether the snapshots have to carry the counters of every node
+        virtual bool perNode() const {
+            return false;
+        }
         virtual ~BackendInterface() {
             
         }
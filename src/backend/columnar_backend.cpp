@@ -0,0 +1,66 @@
+#include "columnar_backend.hpp"
+#include <iostream>
+
+ColumnarBackend::ColumnarBackend(std::string filename, unsigned long long n, std::string algorithm, int parameter, std::string regime) : _filename(filename) {
+    _file = fopen(filename.c_str(), "wb");
+    if (!_file)
+    {
+        std::cerr << "Could not open " << filename << " for writing the metrics" << std::endl;
+        std::exit(-1);
+    }
+    printf("Metrics file %s is opened\n", filename.c_str());
+    ColumnarFileHeader header{COLUMNAR_MAGIC, n, parameter, (uint32_t)algorithm.length(), (uint32_t)regime.length()};
+    write(&header, sizeof(header));
+    write(algorithm.data(), algorithm.length());
+    write(regime.data(), regime.length());
+}
+
+void ColumnarBackend::write(const void *data, size_t bytes) {
+    if (bytes && fwrite(data, 1, bytes, _file) != bytes)
+    {
+        std::cerr << "Could not write the metrics to " << _filename << std::endl;
+        std::exit(-1);
+    }
+}
+
+void ColumnarBackend::dump(std::vector<MetricsSnapshot> &batch) {
+    for (auto &m : batch)
+    {
+        for (auto &column : _columns)
+        {
+            column.clear();
+        }
+        unsigned long long last = 0;
+        for (auto &node : m.nodes)
+        {
+            put_varint(_columns[col_node], node.nodeId - last);
+            put_varint(_columns[col_insertions], node.insertions);
+            put_varint(_columns[col_relaxations], node.relaxed ? node.edgeRelaxations + 1 : 0);
+            last = node.nodeId;
+        }
+        for (auto count : m.insertionsPerStep)
+        {
+            put_varint(_columns[col_steps], count);
+        }
+
+        ColumnarRoundHeader header{m.sourceNode, (uint32_t)m.processors, (uint32_t)m.sampleRate, m.nodes.size(), m.insertionsPerStep.size(), {}};
+        for (int c = 0; c < COLUMNAR_COLUMNS; c++)
+        {
+            header.bytes[c] = _columns[c].size();
+        }
+        write(&header, sizeof(header));
+        for (auto &column : _columns)
+        {
+            write(column.data(), column.size());
+        }
+    }
+    fflush(_file);
+}
+
+ColumnarBackend::~ColumnarBackend() {
+    if (_file && fclose(_file) != 0)
+    {
+        std::cerr << "Could not write the metrics to " << _filename << std::endl;
+    }
+    _file = nullptr;
+}
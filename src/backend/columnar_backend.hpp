@@ -0,0 +1,30 @@
+#ifndef __COLUMNAR_BACKEND_HPP__
+#define __COLUMNAR_BACKEND_HPP__
+
+#include "backend_interface.hpp"
+#include "columnar_format.hpp"
+#include <cstdio>
+#include <string>
+
+// Writes the counters of every node of every round to a local file in the layout of columnar_format.hpp, for
+// reinsertion analyses that are too large for the database backends. Read it back with ColumnarReader or read_metrics
+class ColumnarBackend : public BackendInterface {
+    public:
+        void dump(std::vector<MetricsSnapshot> &batch) final;
+        bool perNode() const final {
+            return true;
+        }
+
+        ColumnarBackend(std::string filename, unsigned long long n, std::string algorithm, int parameter, std::string regime);
+        ~ColumnarBackend();
+
+    private:
+        FILE *_file;
+        std::string _filename;
+        // Encoded columns of the current round, kept to reuse their memory
+        std::string _columns[COLUMNAR_COLUMNS];
+
+        void write(const void *data, size_t bytes);
+};
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef __COLUMNAR_FORMAT_HPP__
+#define __COLUMNAR_FORMAT_HPP__
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../varint.hpp"
+
+/*
+Layout of the files of ColumnarBackend, all integers little endian:
+    ColumnarFileHeader, then the algorithm and regime names (without terminator)
+    per round: ColumnarRoundHeader, then COLUMNAR_COLUMNS columns of bytes[c] bytes each
+The columns are varint encoded, one value per node in increasing order of node id, except col_steps with one value per step:
+    col_node          gap to the previous node id (the first one is the id itself)
+    col_insertions    insertions of the node
+    col_relaxations   0 if the node was never relaxed, otherwise 1 + the edges relaxed from it
+    col_steps         distinct nodes inserted in the step, scaled by the sample rate
+With a sample rate R > 1 only the sampled nodes are listed. A reader can skip any column by its size
+*/
+constexpr uint64_t COLUMNAR_MAGIC = 0x314c4f4350535353ULL; // "SSSPCOL1"
+
+enum ColumnarColumn { col_node = 0, col_insertions, col_relaxations, col_steps, COLUMNAR_COLUMNS };
+
+struct ColumnarFileHeader {
+    uint64_t magic;
+    uint64_t n;
+    int64_t parameter;
+    uint32_t algorithm_length;
+    uint32_t regime_length;
+};
+
+struct ColumnarRoundHeader {
+    uint64_t source;
+    uint32_t processors;
+    uint32_t sample_rate;
+    uint64_t nodes;
+    uint64_t steps;
+    uint64_t bytes[COLUMNAR_COLUMNS];
+};
+
+// One decoded round, the node vectors stay empty if the reader skipped them
+struct ColumnarRound {
+    ColumnarRoundHeader header;
+    std::vector<uint64_t> node;
+    std::vector<uint64_t> insertions;
+    std::vector<uint64_t> relaxations;
+    std::vector<uint64_t> steps;
+};
+
+class ColumnarReader {
+    private:
+        FILE *_file;
+        std::string _buffer;
+        bool _truncated;
+
+        bool readColumn(uint64_t bytes, uint64_t count, std::vector<uint64_t> &out, bool gaps) {
+            _buffer.resize(bytes);
+            if (bytes && fread(&_buffer[0], 1, bytes, _file) != bytes) {
+                return false;
+            }
+            const unsigned char *p = (const unsigned char *)_buffer.data();
+            const unsigned char *end = p + bytes;
+            out.resize(count);
+            uint64_t last = 0;
+            for (uint64_t i = 0; i < count; i++) {
+                if (p >= end) {
+                    return false;
+                }
+                out[i] = get_varint(p);
+                if (gaps) {
+                    out[i] += last;
+                    last = out[i];
+                }
+            }
+            return p == end;
+        }
+
+        bool readRound(ColumnarRound &round, bool nodes) {
+            ColumnarRoundHeader &h = round.header;
+            if (nodes) {
+                if (!readColumn(h.bytes[col_node], h.nodes, round.node, true) ||
+                    !readColumn(h.bytes[col_insertions], h.nodes, round.insertions, false) ||
+                    !readColumn(h.bytes[col_relaxations], h.nodes, round.relaxations, false)) {
+                    return false;
+                }
+            } else {
+                round.node.clear();
+                round.insertions.clear();
+                round.relaxations.clear();
+                if (fseek(_file, h.bytes[col_node] + h.bytes[col_insertions] + h.bytes[col_relaxations], SEEK_CUR)) {
+                    return false;
+                }
+            }
+            return readColumn(h.bytes[col_steps], h.steps, round.steps, false);
+        }
+
+    public:
+        ColumnarFileHeader header;
+        std::string algorithm;
+        std::string regime;
+
+        ColumnarReader(const std::string &path) {
+            _file = fopen(path.c_str(), "rb");
+            _truncated = false;
+        }
+        ~ColumnarReader() {
+            if (_file) {
+                fclose(_file);
+            }
+        }
+
+        // Reads the file header, false if the file is missing or of another format
+        bool open() {
+            if (!_file || fread(&header, sizeof(header), 1, _file) != 1 || header.magic != COLUMNAR_MAGIC) {
+                return false;
+            }
+            algorithm.resize(header.algorithm_length);
+            regime.resize(header.regime_length);
+            return (!header.algorithm_length || fread(&algorithm[0], 1, header.algorithm_length, _file) == header.algorithm_length) &&
+                   (!header.regime_length || fread(&regime[0], 1, header.regime_length, _file) == header.regime_length);
+        }
+
+        // Decodes the next round, with nodes = false the per-node columns are skipped. False at the end of the file
+        // or if the round is incomplete, see truncated()
+        bool next(ColumnarRound &round, bool nodes = true) {
+            ColumnarRoundHeader &h = round.header;
+            size_t got = fread(&h, 1, sizeof(h), _file);
+            if (got != sizeof(h)) {
+                _truncated = got > 0;
+                return false;
+            }
+            _truncated = !readRound(round, nodes);
+            return !_truncated;
+        }
+
+        // Whether reading stopped in the middle of a round, e.g. because the run was killed
+        bool truncated() const {
+            return _truncated;
+        }
+
+};
+
+#endif
@@ -1,55 +1,87 @@
 #include "postgres_backend.hpp"
-#include <openssl/sha.h>
 #include <cilk/cilk.h>
 #include <cilk/cilk_api.h>
 
-void PostgresBackend::dump(SSSPMetrics *metrics, unsigned long long sourceNode) {
-    auto lck = std::unique_lock<std::mutex>(_access_guard);
-
-    unsigned long reinserts = 0;
-    for(auto &entry : metrics->getInsertionsPerNode()) {
-        reinserts+=entry.second-1;
+void PostgresBackend::exec(const char *sql, const char *step) {
+    PGresult *res = PQexec(_database, sql);
+    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+        exit_err(step,res);
     }
-    std::string insertSSSP = "INSERT INTO SSSPExecution (graph_id,source_node, algorithm, algorithmParameter,processors,reinserts) VALUES (" + _postgresGraphId + "," + std::to_string(sourceNode) + ",'" + _algorithm + "'," + std::to_string(_algorithmParameter) + ","+std::to_string(__cilkrts_get_nworkers())+ ","+std::to_string(reinserts)+") RETURNING id;";
+    PQclear(res);
+}
 
-    PGresult *res = PQexec(_database, insertSSSP.c_str());
-    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-        exit_err("Could not insert data into SSSPExecution",res);
+void PostgresBackend::copy(const std::string &into, const std::string &rows) {
+    std::string statement = "COPY " + into + " FROM STDIN;";
+    PGresult *res = PQexec(_database, statement.c_str());
+    if (PQresultStatus(res) != PGRES_COPY_IN) {
+        exit_err(("Could not start copying into " + into).c_str(),res);
     }
-
-    int tupleCount = PQntuples(res);
-    std::string id;
-    if(tupleCount==1) {
-        id = PQgetvalue(res, 0, 0);
+    PQclear(res);
+    if (PQputCopyData(_database, rows.data(), rows.size()) != 1 || PQputCopyEnd(_database, NULL) != 1) {
+        exit_err(("Could not copy into " + into).c_str(),nullptr);
     }
-    else {
-        exit_err("Could not retrieve id after inserting data into SSSPExecution",res);
+    res = PQgetResult(_database);
+    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+        exit_err(("Could not copy into " + into).c_str(),res);
     }
+    PQclear(res);
+    // Drain the results until the connection is idle again
+    while ((res = PQgetResult(_database))) {
+        PQclear(res);
+    }
+}
 
-    const char* insertPoint = "INSERT INTO SSSPExecutionStep (sssp_source_id,total_vertices,step) VALUES ($1,$2,$3)";
-    int step = 0;
-
+void PostgresBackend::dump(std::vector<MetricsSnapshot> &batch) {
+    exec("BEGIN;", "Could not start a transaction");
 
+    // Reserve the ids of the batch up front so every table can be loaded with one COPY
+    std::string reserve = "SELECT nextval(pg_get_serial_sequence('ssspexecution','id')) FROM generate_series(1," + std::to_string(batch.size()) + ");";
+    PGresult *res = PQexec(_database, reserve.c_str());
+    if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) != (int)batch.size()) {
+        exit_err("Could not reserve ids in SSSPExecution",res);
+    }
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < batch.size(); i++) {
+        ids.push_back(PQgetvalue(res, i, 0));
+    }
+    PQclear(res);
 
-    for (auto &map : metrics->getRoundMetrics())
-    {
-        std::string metrics_size = std::to_string(map.size());
-        std::string step_str = std::to_string(step);
-        const char *paramValues[3];
-        paramValues[0] = id.c_str();
-        paramValues[1] = metrics_size.c_str();
-        paramValues[2] = step_str.c_str();
+    // Rows in the text format of COPY, tab separated with \N for NULL
+    std::string executions, steps, perf;
+    for (size_t i = 0; i < batch.size(); i++) {
+        auto &m = batch[i];
+        // Every inserted node counts one insertion that is not a reinsert
+        unsigned long reinserts = m.insertions.total - m.insertions.count * m.sampleRate;
+        executions += ids[i] + "\t" + _postgresGraphId + "\t" + _algorithm + "\t" + std::to_string(_algorithmParameter) + "\t"
+                    + std::to_string(m.sourceNode) + "\t" + std::to_string(m.processors) + "\t" + std::to_string(reinserts) + "\n";
+
+        for (size_t step = 0; step < m.insertionsPerStep.size(); step++) {
+            steps += ids[i] + "\t" + std::to_string(m.insertionsPerStep[step]) + "\t" + std::to_string(step) + "\n";
+        }
 
-        res = PQexecParams(_database, insertPoint, 3, NULL, paramValues, 
-            NULL, NULL, 0);
-        if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-            exit_err("Could not insert data into SSSPExecutionStep",res);
+        for (auto &c : m.phaseCounters) {
+            perf += ids[i] + "\t" + c.phase + "\t" + std::to_string(c.seconds);
+            for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+                // Events the machine does not count are stored as NULL
+                perf += "\t" + (c.events[e] < 0 ? std::string("\\N") : std::to_string(c.events[e]));
+            }
+            perf += "\n";
         }
-        else {
-            PQclear(res);
+    }
+
+    copy("SSSPExecution (id,graph_id,algorithm,algorithmParameter,source_node,processors,reinserts)", executions);
+    if (!steps.empty()) {
+        copy("SSSPExecutionStep (sssp_source_id,total_vertices,step)", steps);
+    }
+    if (!perf.empty()) {
+        std::string columns = "SSSPExecutionPerf (sssp_source_id,phase,seconds";
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+            columns += std::string(",") + PERF_EVENT_NAMES[e];
         }
-        step+=1;
+        copy(columns + ")", perf);
     }
+
+    exec("COMMIT;", "Could not commit the metrics");
 }
 
 void PostgresBackend::exit_err(const char *step, PGresult *result) {
@@ -63,7 +95,7 @@ void PostgresBackend::exit_err(const char *step, PGresult *result) {
     std::exit(-1);
 }
 
-PostgresBackend::PostgresBackend(std::string user, std::string password, std::string host, int port, std::string datbase, std::string graphAdj, std::string algorithm, int parameter) : _algorithm(algorithm), _algorithmParameter(parameter) {
+PostgresBackend::PostgresBackend(std::string user, std::string password, std::string host, int port, std::string datbase, std::vector<std::string> graphDigests, std::string algorithm, int parameter) : _algorithm(algorithm), _algorithmParameter(parameter) {
     _database = nullptr;
 
     std::string login = "user="+user+" password="+password+" host="+host+" port="+std::to_string(port)+" dbname="+datbase;
@@ -86,36 +118,41 @@ PostgresBackend::PostgresBackend(std::string user, std::string password, std::st
     }
     PQclear(res);
 
-    unsigned char hash[SHA_DIGEST_LENGTH];
-
-    SHA1((const unsigned char*)graphAdj.c_str(), graphAdj.length(), hash);
-
-    char buf[SHA_DIGEST_LENGTH*2+1];
-    for (int i=0; i<SHA_DIGEST_LENGTH; i++) {
-        sprintf(buf+i*2, "%02x", hash[i]);
+    std::string create_sssp_perf_sql = "CREATE TABLE IF NOT EXISTS SSSPExecutionPerf (sssp_source_id INTEGER, phase TEXT, seconds DOUBLE PRECISION, ";
+    for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+        create_sssp_perf_sql += std::string(PERF_EVENT_NAMES[e]) + " BIGINT, ";
     }
-    buf[SHA_DIGEST_LENGTH*2]=0;
-
+    create_sssp_perf_sql += "FOREIGN KEY(sssp_source_id) REFERENCES SSSPExecution(id));";
+    res = PQexec(_database, create_sssp_perf_sql.c_str());
+    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+        exit_err("Connection to database failed",res);
+    }
+    PQclear(res);
 
+    // The first digest that is registered in the Graph table identifies the graph
     const char *statement = "SELECT id FROM Graph WHERE hash_digest=$1;";
-    const char *paramValues[1];
-    paramValues[0] = buf;
-    res = PQexecParams(_database, statement, 1, NULL, paramValues, 
-        NULL, NULL, 0);
+    for (auto &digest : graphDigests) {
+        const char *paramValues[1];
+        paramValues[0] = digest.c_str();
+        res = PQexecParams(_database, statement, 1, NULL, paramValues,
+            NULL, NULL, 0);
 
-    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-        exit_err("Could not read graph",res);
+        if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+            exit_err("Could not read graph",res);
+        }
+        if (PQntuples(res) > 0) {
+            _postgresGraphId = PQgetvalue(res, 0, 0);
+        }
+        PQclear(res);
+        if (!_postgresGraphId.empty()) {
+            break;
+        }
     }
-
-    int results = PQntuples(res);
     // Graph does not exist yet, insert it ourselves
-    if(results == 0) {
-        exit_err("Does not support inserting the graph yet!",res);
+    if (_postgresGraphId.empty()) {
+        fprintf(stderr, "Graph digest: %s\n", graphDigests[0].c_str());
+        exit_err("Does not support inserting the graph yet!",nullptr);
     }
-    else {
-        _postgresGraphId = PQgetvalue(res, 0, 0);
-    }
-    PQclear(res);
 }
 
 
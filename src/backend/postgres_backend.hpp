@@ -3,20 +3,24 @@
 
 #include "backend_interface.hpp"
 #include <string>
+#include <vector>
 #include <libpq-fe.h>
 
 class PostgresBackend : public BackendInterface {
     public:
-        void dump(SSSPMetrics *metrics, unsigned long long sourceNode) final;
+        void dump(std::vector<MetricsSnapshot> &batch) final;
 
-        PostgresBackend(std::string user, std::string password, std::string host, int port, std::string datbase, std::string graphAdj, std::string algorithm, int parameter);
+        // graphDigests are the candidate identities of the graph, in order of preference
+        PostgresBackend(std::string user, std::string password, std::string host, int port, std::string datbase, std::vector<std::string> graphDigests, std::string algorithm, int parameter);
         ~PostgresBackend();
 
         void exit_err(const char *step, PGresult *res);
 
     private:
-        // Protect functions which mutate the state from race conditions
-        std::mutex _access_guard;
+        // Runs a statement without results, exits with step as the message on errors
+        void exec(const char *sql, const char *step);
+        // Loads rows in the text format of COPY into a table with its column list
+        void copy(const std::string &into, const std::string &rows);
 
         // The graphId in the sqlite database
         std::string _postgresGraphId;
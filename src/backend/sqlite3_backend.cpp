@@ -1,9 +1,8 @@
 #include "sqlite3_backend.hpp"
+#include <algorithm>
 #include <iostream>
 #include <cilk/cilk.h>
 #include <cilk/cilk_api.h>
-#include <openssl/sha.h>
-#include "../metrics/stats.hpp"
 
 
 int dummy_reader(void *, int, char **, char **)
@@ -11,7 +10,7 @@ int dummy_reader(void *, int, char **, char **)
     return 0;
 }
 
-Sqlite3Backend::Sqlite3Backend(std::string filename, std::string graphAdj, std::string algorithm, int parameter, std::string regime) : _algorithm(algorithm),_regime(regime), _algorithmParameter(parameter) {
+Sqlite3Backend::Sqlite3Backend(std::string filename, std::vector<std::string> graphDigests, std::string algorithm, int parameter, std::string regime) : _algorithm(algorithm),_regime(regime), _algorithmParameter(parameter) {
      _sqliteGraphId = -1;
 
     // Initialize the database
@@ -49,6 +48,15 @@ Sqlite3Backend::Sqlite3Backend(std::string filename, std::string graphAdj, std::
                                                 "step INTEGER,"
                                                 "FOREIGN KEY(sssp_source_id) REFERENCES SSSPExecution(id));";
 
+    std::string create_sssp_perf_sql = "CREATE TABLE IF NOT EXISTS SSSPExecutionPerf ("
+                                        "sssp_source_id INTEGER,"
+                                        "phase TEXT,"
+                                        "seconds REAL,";
+    for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+        create_sssp_perf_sql += std::string(PERF_EVENT_NAMES[e]) + " INTEGER,";
+    }
+    create_sssp_perf_sql += "FOREIGN KEY(sssp_source_id) REFERENCES SSSPExecution(id));";
+
     char *errorMsg = 0;
 
     result = sqlite3_exec(_database, create_sssp_source_sql, dummy_reader, 0, &errorMsg);
@@ -65,77 +73,72 @@ Sqlite3Backend::Sqlite3Backend(std::string filename, std::string graphAdj, std::
         sqlite3_free(errorMsg);
     }
 
-    unsigned char hash[SHA_DIGEST_LENGTH];
-
-    SHA1((const unsigned char*)graphAdj.c_str(), graphAdj.length(), hash);
-
-    char buf[SHA_DIGEST_LENGTH*2+1];
-    for (int i=0; i<SHA_DIGEST_LENGTH; i++) {
-        sprintf(buf+i*2, "%02x", hash[i]);
+    result = sqlite3_exec(_database, create_sssp_perf_sql.c_str(), dummy_reader, 0, &errorMsg);
+    if (result != SQLITE_OK)
+    {
+        std::cerr << "SQL error: " << errorMsg << std::endl;
+        sqlite3_free(errorMsg);
     }
-    buf[SHA_DIGEST_LENGTH*2]=0;
-
 
+    // The first digest that is registered in the Graph table identifies the graph
     std::string statement = "SELECT id FROM Graph WHERE hash_digest=?;";
-    sqlite3_stmt *find_graph_stmt = nullptr;
-    result = sqlite3_prepare_v2(
-        _database,          // the handle to your (opened and ready) database
-        statement.c_str(),  // the sql statement, utf-8 encoded
-        statement.length(), // max length of sql statement
-        &find_graph_stmt,   // this is an "out" parameter, the compiled statement goes here
-        nullptr);           // pointer to the tail end of sql statement (when there are
-    result = sqlite3_bind_text(
-        find_graph_stmt,   // previously compiled prepared statement object
-        1,                 // parameter index, 1-based
-        buf,  // the data
-        SHA_DIGEST_LENGTH*2, // length of data
-        SQLITE_STATIC);    // this parameter is a little tricky - it's a pointer to the callback
-
-    auto stepResult = sqlite3_step(find_graph_stmt);
-    if (stepResult == SQLITE_ROW)
+    sqlite3_stmt *find_graph_stmt = prepare(statement);
+    for (auto &digest : graphDigests)
     {
-        _sqliteGraphId = sqlite3_column_int(find_graph_stmt, 0);
+        sqlite3_bind_text(find_graph_stmt, 1, digest.c_str(), digest.length(), SQLITE_STATIC);
+        if (sqlite3_step(find_graph_stmt) == SQLITE_ROW)
+        {
+            _sqliteGraphId = sqlite3_column_int(find_graph_stmt, 0);
+        }
+        sqlite3_reset(find_graph_stmt);
+        if (_sqliteGraphId != -1)
+        {
+            break;
+        }
     }
-    else
+    sqlite3_finalize(find_graph_stmt);
+    if (_sqliteGraphId == -1)
     {
-        std::cerr<<"Could not find graph!"<<std::endl;
+        std::cerr<<"Could not find graph! Register its digest "<<graphDigests[0]<<" in the Graph table"<<std::endl;
         std::exit(-1);
     }
-    sqlite3_finalize(find_graph_stmt);
 }
 
-void Sqlite3Backend::dump(SSSPMetrics *metrics, unsigned long long sourceNode) {
-    auto lck = std::unique_lock<std::mutex>(_access_guard);
-    sqlite3_stmt *insert_point = nullptr;
+void Sqlite3Backend::exec(const char *sql) {
     char *errorMsg = nullptr;
-    auto result = sqlite3_exec(_database, "BEGIN TRANSACTION;", nullptr, nullptr, &errorMsg);
+    auto result = sqlite3_exec(_database, sql, nullptr, nullptr, &errorMsg);
     if (result != SQLITE_OK)
     {
         std::cerr << "SQL error: " << errorMsg << std::endl;
         sqlite3_free(errorMsg);
         std::exit(-1);
     }
-    std::string insertPoint = "INSERT INTO SSSPExecutionStep (sssp_source_id,total_vertices,step) VALUES (?,?,?)";
-    
-    int step = 0;
-    std::vector<unsigned long> inserts_vec;
-    for(auto &entry : metrics->getInsertionsPerNode()) {
-        inserts_vec.push_back(entry.second);
-    }
-
-    VectorStats<unsigned long> stats_insert(&inserts_vec, 0);
-
-
-    std::vector<unsigned long> relaxations_vec;
+}
 
-    for(auto &entry : metrics->getEdgeRelaxationsPerNode()) {
-        relaxations_vec.push_back(entry.second);
+sqlite3_stmt *Sqlite3Backend::prepare(const std::string &sql) {
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(_database, sql.c_str(), sql.length(), &stmt, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "SQL error: " << sqlite3_errmsg(_database) << std::endl;
+        std::exit(-1);
     }
+    return stmt;
+}
 
-    VectorStats<unsigned long> stats_relaxations(&relaxations_vec, 0);
+// INSERT of rows rows into SSSPExecutionStep
+static std::string insert_steps_sql(size_t rows) {
+    std::string sql = "INSERT INTO SSSPExecutionStep (sssp_source_id,total_vertices,step) VALUES ";
+    for (size_t i = 0; i < rows; i++)
+    {
+        sql += i ? ",(?,?,?)" : "(?,?,?)";
+    }
+    return sql;
+}
 
+void Sqlite3Backend::dump(std::vector<MetricsSnapshot> &batch) {
+    exec("BEGIN TRANSACTION;");
 
-    std::string insertSSSP = "INSERT INTO SSSPExecution (graph_id,source_node, algorithm, algorithmParameter,regime,processors,"
+    sqlite3_stmt *insert_sssp = prepare("INSERT INTO SSSPExecution (graph_id,source_node, algorithm, algorithmParameter,regime,processors,"
                                 "reinserts_total,"
                                 "reinserts_mean,"
                                 "reinserts_median,"
@@ -146,70 +149,104 @@ void Sqlite3Backend::dump(SSSPMetrics *metrics, unsigned long long sourceNode) {
                                 "edge_relaxations_median,"
                                 "edge_relaxations_quartile1,"
                                 "edge_relaxations_quartile3"
-                                ") VALUES (" + std::to_string(_sqliteGraphId) + "," + std::to_string(sourceNode) + ",\"" + _algorithm + "\"," + std::to_string(_algorithmParameter)+ ",\"" + _regime + "\"," +std::to_string(__cilkrts_get_nworkers())+ ","
-                                    +std::to_string(stats_insert.sum())
-                                    +","
-                                    +std::to_string(stats_insert.mean())
-                                    +","
-                                    +std::to_string(stats_insert.median())
-                                    +","
-                                    +std::to_string(stats_insert.first_quartile())
-                                    +","
-                                    +std::to_string(stats_insert.third_quartile())
-                                    +","
-                                    +std::to_string(stats_relaxations.sum())
-                                    +","
-                                    +std::to_string(stats_relaxations.mean())
-                                    +","
-                                    +std::to_string(stats_relaxations.median())
-                                    +","
-                                    +std::to_string(stats_relaxations.first_quartile())
-                                    +","
-                                    +std::to_string(stats_relaxations.third_quartile())
-                                    +");";
-
-    long long id = -1;
-    result = sqlite3_exec(_database, insertSSSP.c_str(), dummy_reader, &id, &errorMsg);
+                                ") VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)");
+    // The steps of a round are written SQLITE_STEP_ROWS at a time, the rest with one statement of the remaining size
+    sqlite3_stmt *insert_steps = prepare(insert_steps_sql(SQLITE_STEP_ROWS));
+    sqlite3_stmt *insert_perf = nullptr;
 
-    if (result != SQLITE_OK)
-    {
-        std::cerr << "SQL error: " << errorMsg << std::endl;
-        sqlite3_free(errorMsg);
-        std::exit(-1);
-    }
-    id = sqlite3_last_insert_rowid(_database);
-    result = sqlite3_prepare_v2(
-        _database,            // the handle to your (opened and ready) database
-        insertPoint.c_str(),  // the sql statement, utf-8 encoded
-        insertPoint.length(), // max length of sql statement
-        &insert_point,        // this is an "out" parameter, the compiled statement goes here
-        nullptr);             // pointer to the tail end of sql statement (when there are
-    result = sqlite3_bind_int(
-        insert_point, // previously compiled prepared statement object
-        1,            // parameter index, 1-based
-        id);
-    for (auto &map : metrics->getRoundMetrics())
+    for (auto &m : batch)
     {
-        result = sqlite3_bind_int(
-            insert_point, // previously compiled prepared statement object
-            2,            // parameter index, 1-based
-            map.size());
-        result = sqlite3_bind_int(
-            insert_point, // previously compiled prepared statement object
-            3,            // parameter index, 1-based
-            step);
-        sqlite3_step(insert_point);
-        sqlite3_reset(insert_point);
-        step++;
-    }
-    sqlite3_finalize(insert_point);
-    result = sqlite3_exec(_database, "END TRANSACTION;", nullptr, nullptr, &errorMsg);
-    if (result != SQLITE_OK)
-    {
-        std::cerr << "SQL error: " << errorMsg << std::endl;
-        sqlite3_free(errorMsg);
-        std::exit(-1);
+        sqlite3_bind_int(insert_sssp, 1, _sqliteGraphId);
+        sqlite3_bind_int64(insert_sssp, 2, m.sourceNode);
+        sqlite3_bind_text(insert_sssp, 3, _algorithm.c_str(), _algorithm.length(), SQLITE_STATIC);
+        sqlite3_bind_int(insert_sssp, 4, _algorithmParameter);
+        sqlite3_bind_text(insert_sssp, 5, _regime.c_str(), _regime.length(), SQLITE_STATIC);
+        sqlite3_bind_int(insert_sssp, 6, m.processors);
+        sqlite3_bind_int64(insert_sssp, 7, m.insertions.total);
+        sqlite3_bind_double(insert_sssp, 8, m.insertions.mean);
+        sqlite3_bind_int64(insert_sssp, 9, m.insertions.median);
+        sqlite3_bind_int64(insert_sssp, 10, m.insertions.firstQuartile);
+        sqlite3_bind_int64(insert_sssp, 11, m.insertions.thirdQuartile);
+        sqlite3_bind_int64(insert_sssp, 12, m.edgeRelaxations.total);
+        sqlite3_bind_double(insert_sssp, 13, m.edgeRelaxations.mean);
+        sqlite3_bind_int64(insert_sssp, 14, m.edgeRelaxations.median);
+        sqlite3_bind_int64(insert_sssp, 15, m.edgeRelaxations.firstQuartile);
+        sqlite3_bind_int64(insert_sssp, 16, m.edgeRelaxations.thirdQuartile);
+        if (sqlite3_step(insert_sssp) != SQLITE_DONE)
+        {
+            std::cerr << "SQL error: " << sqlite3_errmsg(_database) << std::endl;
+            std::exit(-1);
+        }
+        sqlite3_reset(insert_sssp);
+        long long id = sqlite3_last_insert_rowid(_database);
+
+        auto &steps = m.insertionsPerStep;
+        for (size_t first = 0; first < steps.size(); first += SQLITE_STEP_ROWS)
+        {
+            size_t rows = std::min(SQLITE_STEP_ROWS, steps.size() - first);
+            sqlite3_stmt *stmt = rows == SQLITE_STEP_ROWS ? insert_steps : prepare(insert_steps_sql(rows));
+            for (size_t i = 0; i < rows; i++)
+            {
+                sqlite3_bind_int64(stmt, 3 * i + 1, id);
+                sqlite3_bind_int64(stmt, 3 * i + 2, steps[first + i]);
+                sqlite3_bind_int64(stmt, 3 * i + 3, first + i);
+            }
+            if (sqlite3_step(stmt) != SQLITE_DONE)
+            {
+                std::cerr << "SQL error: " << sqlite3_errmsg(_database) << std::endl;
+                std::exit(-1);
+            }
+            if (stmt == insert_steps)
+            {
+                sqlite3_reset(stmt);
+            }
+            else
+            {
+                sqlite3_finalize(stmt);
+            }
+        }
+
+        if (!m.phaseCounters.empty() && !insert_perf)
+        {
+            std::string insertPerf = "INSERT INTO SSSPExecutionPerf (sssp_source_id,phase,seconds";
+            std::string values = "(?,?,?";
+            for (int e = 0; e < NUM_PERF_EVENTS; e++)
+            {
+                insertPerf += std::string(",") + PERF_EVENT_NAMES[e];
+                values += ",?";
+            }
+            insert_perf = prepare(insertPerf + ") VALUES " + values + ")");
+        }
+        for (auto &c : m.phaseCounters)
+        {
+            sqlite3_bind_int64(insert_perf, 1, id);
+            sqlite3_bind_text(insert_perf, 2, c.phase.c_str(), c.phase.length(), SQLITE_TRANSIENT);
+            sqlite3_bind_double(insert_perf, 3, c.seconds);
+            for (int e = 0; e < NUM_PERF_EVENTS; e++)
+            {
+                // Events the machine does not count are stored as NULL
+                if (c.events[e] < 0)
+                {
+                    sqlite3_bind_null(insert_perf, 4 + e);
+                }
+                else
+                {
+                    sqlite3_bind_int64(insert_perf, 4 + e, c.events[e]);
+                }
+            }
+            if (sqlite3_step(insert_perf) != SQLITE_DONE)
+            {
+                std::cerr << "SQL error: " << sqlite3_errmsg(_database) << std::endl;
+                std::exit(-1);
+            }
+            sqlite3_reset(insert_perf);
+        }
     }
+    sqlite3_finalize(insert_sssp);
+    sqlite3_finalize(insert_steps);
+    sqlite3_finalize(insert_perf);
+
+    exec("END TRANSACTION;");
 }
 
 Sqlite3Backend::~Sqlite3Backend() {
@@ -3,18 +3,22 @@
 
 #include "backend_interface.hpp"
 #include "sqlite3.h"
-#include <mutex>
+
+// Rows per multi-row INSERT into SSSPExecutionStep, 3 parameters each stay below the default SQLITE_MAX_VARIABLE_NUMBER
+constexpr size_t SQLITE_STEP_ROWS = 300;
 
 class Sqlite3Backend : public BackendInterface {
     public:
-        void dump(SSSPMetrics *metrics, unsigned long long sourceNode) final;
+        void dump(std::vector<MetricsSnapshot> &batch) final;
 
-        Sqlite3Backend(std::string filename, std::string graphAdj, std::string algorithm, int parameter, std::string regime);
+        // graphDigests are the candidate identities of the graph, in order of preference
+        Sqlite3Backend(std::string filename, std::vector<std::string> graphDigests, std::string algorithm, int parameter, std::string regime);
         ~Sqlite3Backend();
 
     private:
-        // Protect functions which mutate the state from race conditions
-        std::mutex _access_guard;
+        // Runs a statement without results, exits on errors
+        void exec(const char *sql);
+        sqlite3_stmt *prepare(const std::string &sql);
 
         // The database to store the records
         sqlite3 *_database;
@@ -0,0 +1,188 @@
+#pragma once
+#include <memory>
+
+#include "bitmap.hpp"
+#include "sssp.h"
+
+constexpr size_t BFS_ALPHA = 15;
+constexpr size_t BFS_BETA = 18;
+
+// Direction-optimizing BFS (Beamer, Asanovic, Patterson) for hop distances.
+// Top-down rounds expand a vertex queue, bottom-up rounds let every
+// unvisited vertex look for a parent in the bitmap of the frontier. The
+// switch follows Beamer's heuristic: go bottom-up once the frontier's edges
+// exceed the unexplored edges / BFS_ALPHA, go back once the frontier drops
+// below n / BFS_BETA vertices.
+class BFS : public SSSPSolver {
+ private:
+  // In-edges for bottom-up rounds
+  struct InEdges {
+    sequence<EdgeId> offset;
+    sequence<NodeId> edge;
+  };
+
+  const Graph &G;
+  // only built for directed graphs, shared with the clones
+  std::shared_ptr<const InEdges> in;
+  sequence<EdgeTy> dist;
+  sequence<NodeId> queue;
+  Bitmap front, next;
+  SSSPMetrics *metrics;
+
+  const EdgeId *parent_offset() const {
+    return in ? in->offset.begin() : G.offset.begin();
+  }
+  NodeId parent(EdgeId j) const {
+    return in ? in->edge[j] : G.edge[j].v;
+  }
+
+  static std::shared_ptr<const InEdges> transpose(const Graph &G) {
+    auto t = std::make_shared<InEdges>();
+    t->offset = sequence<EdgeId>(G.n + 1);
+    t->edge = sequence<NodeId>(G.m);
+    parallel_for(0, G.n + 1, [&](size_t i) { t->offset[i] = 0; });
+    parallel_for(0, G.n, [&](size_t i) {
+      for (size_t j = G.offset[i]; j < G.offset[i + 1]; j++) {
+        write_add(&t->offset[G.edge[j].v], 1);
+      }
+    });
+    scan_inplace(t->offset.slice(),
+                 monoid([](EdgeId a, EdgeId b) { return a + b; }, 0));
+    sequence<EdgeId> pos = t->offset;
+    parallel_for(0, G.n, [&](size_t i) {
+      for (size_t j = G.offset[i]; j < G.offset[i + 1]; j++) {
+        t->edge[fetch_and_add(&pos[G.edge[j].v], 1)] = i;
+      }
+    });
+    return t;
+  }
+
+  size_t degree(NodeId u) const { return G.offset[u + 1] - G.offset[u]; }
+
+  // Expands the queue, returns the out-edges of the new frontier
+  size_t top_down(EdgeTy level) {
+    sequence<EdgeId> pos(queue.size() + 1);
+    parallel_for(0, queue.size(), [&](size_t i) { pos[i] = degree(queue[i]); });
+    pos[queue.size()] = 0;
+    size_t total = scan_inplace(
+        pos.slice(), monoid([](EdgeId a, EdgeId b) { return a + b; }, 0));
+    sequence<NodeId> out(total);
+    parallel_for(0, queue.size(), [&](size_t i) {
+      NodeId u = queue[i];
+      if (metrics) {
+        metrics->log_node_relax(u, degree(u));
+      }
+      parallel_for(G.offset[u], G.offset[u + 1], [&](size_t es) {
+        NodeId v = G.edge[es].v;
+        NodeId res = UINT_MAX;
+        if (dist[v] == INT_MAX / 2 &&
+            atomic_compare_and_swap(&dist[v], (EdgeTy)(INT_MAX / 2), level)) {
+          res = v;
+          if (metrics) {
+            metrics->log_node_add(v);
+          }
+        }
+        out[pos[i] + es - G.offset[u]] = res;
+      });
+    });
+    queue = filter(out, [](NodeId v) { return v != UINT_MAX; });
+    return reduce(dseq(queue.size(), [&](size_t i) { return degree(queue[i]); }),
+                  monoid([](size_t a, size_t b) { return a + b; }, 0));
+  }
+
+  // One bottom-up round from front into next, returns the new frontier
+  // size and its out-edges. The in-edges an unvisited vertex scans for a
+  // parent are logged as its relaxations.
+  pair<size_t, size_t> bottom_up(EdgeTy level) {
+    const EdgeId *off = parent_offset();
+    next.clear();
+    parallel_for(0, G.n, [&](size_t v) {
+      if (dist[v] != INT_MAX / 2) {
+        return;
+      }
+      EdgeId j = off[v];
+      for (; j < off[v + 1]; j++) {
+        if (front.get(parent(j))) {
+          dist[v] = level;
+          next.set(v);
+          break;
+        }
+      }
+      if (metrics && off[v] < off[v + 1]) {
+        metrics->log_node_relax(v, min(j + 1, off[v + 1]) - off[v]);
+        if (j < off[v + 1]) {
+          metrics->log_node_add(v);
+        }
+      }
+    });
+    auto cnt = dseq(next.num_words(), [&](size_t w) { return next.word_count(w); });
+    size_t sz = reduce(cnt, monoid([](size_t a, size_t b) { return a + b; }, 0));
+    auto deg = dseq(G.n, [&](size_t v) -> size_t {
+      return next.get(v) ? degree(v) : 0;
+    });
+    size_t edges = reduce(deg, monoid([](size_t a, size_t b) { return a + b; }, 0));
+    swap(front, next);
+    return make_pair(sz, edges);
+  }
+
+  BFS(const Graph &_G, std::shared_ptr<const InEdges> _in, SSSPMetrics *_mets)
+      : G(_G), in(std::move(_in)), metrics(_mets) {
+    dist = sequence<EdgeTy>(G.n);
+    front = Bitmap(G.n);
+    next = Bitmap(G.n);
+  }
+
+ public:
+  BFS() = delete;
+  BFS(const Graph &_G, SSSPMetrics *_mets)
+      : BFS(_G, _G.symmetrized ? nullptr : transpose(_G), _mets) {}
+
+  SSSPSolver *clone() const override { return new BFS(G, in, nullptr); }
+
+  size_t memory_bytes() const override {
+    size_t bytes = queue.size() * sizeof(NodeId) +
+                   dist.size() * sizeof(EdgeTy) + front.bytes() + next.bytes();
+    if (in) {
+      bytes += in->offset.size() * sizeof(EdgeId) +
+               in->edge.size() * sizeof(NodeId);
+    }
+    return bytes;
+  }
+
+  void sssp(int s, EdgeTy *_dist) override {
+    t_all.start();
+    parallel_for(0, G.n, [&](size_t i) { dist[i] = INT_MAX / 2; });
+    dist[s] = 0;
+    queue = sequence<NodeId>(1, (NodeId)s);
+    if (metrics) {
+      metrics->log_node_add(s);
+    }
+    bool bottom = false;
+    size_t sz = 1;
+    size_t edges_f = degree(s);
+    size_t edges_u = G.m - edges_f;
+    for (EdgeTy level = 1; sz; level++) {
+      if (!bottom && edges_f > edges_u / BFS_ALPHA) {
+        bottom = true;
+        front.clear();
+        parallel_for(0, queue.size(), [&](size_t i) { front.set(queue[i]); });
+      } else if (bottom && sz < G.n / BFS_BETA) {
+        bottom = false;
+        queue = filter(dseq(G.n, [](size_t i) { return (NodeId)i; }),
+                       [&](NodeId v) { return front.get(v); });
+      }
+      if (bottom) {
+        tie(sz, edges_f) = bottom_up(level);
+      } else {
+        edges_f = top_down(level);
+        sz = queue.size();
+      }
+      edges_u -= min(edges_u, edges_f);
+      if (metrics) {
+        metrics->incAlgorithmStep();
+      }
+    }
+    t_all.stop();
+    parallel_for(0, G.n, [&](size_t i) { _dist[i] = dist[i]; });
+  }
+};
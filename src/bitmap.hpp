@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+
+#include "../pbbslib/parallel.h"
+#include "../pbbslib/sequence.h"
+using namespace pbbs;
+
+// One bit per vertex, packed into 64-bit words so that scans can skip empty
+// regions a word at a time and sizes can be taken with popcount.
+class Bitmap {
+ public:
+  static constexpr size_t WORD_BITS = 64;
+
+  Bitmap() : n(0) {}
+  explicit Bitmap(size_t _n) : n(_n), words((_n + WORD_BITS - 1) / WORD_BITS) {
+    clear();
+  }
+
+  size_t size() const { return n; }
+  size_t num_words() const { return words.size(); }
+  size_t bytes() const { return words.size() * sizeof(uint64_t); }
+  uint64_t word(size_t w) const { return words[w]; }
+  size_t word_count(size_t w) const { return __builtin_popcountll(words[w]); }
+
+  bool get(size_t i) const {
+    return words[i / WORD_BITS] & (1ULL << (i % WORD_BITS));
+  }
+  // Returns true only for the caller that flipped the bit from 0 to 1
+  bool set(size_t i) {
+    uint64_t mask = 1ULL << (i % WORD_BITS);
+    uint64_t *w = &words[i / WORD_BITS];
+    if (*w & mask) {
+      return false;
+    }
+    return !(__sync_fetch_and_or(w, mask) & mask);
+  }
+  void reset(size_t i) {
+    __sync_fetch_and_and(&words[i / WORD_BITS], ~(1ULL << (i % WORD_BITS)));
+  }
+  void clear_word(size_t w) { words[w] = 0; }
+  void clear() {
+    parallel_for(0, words.size(), [&](size_t i) { words[i] = 0; });
+  }
+
+  // Position of the k-th set bit of a word, k is zero based
+  static size_t select(uint64_t word, size_t k) {
+    while (k--) {
+      word &= word - 1;
+    }
+    return __builtin_ctzll(word);
+  }
+
+ private:
+  size_t n;
+  sequence<uint64_t> words;
+};
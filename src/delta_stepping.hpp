@@ -0,0 +1,275 @@
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "sssp.h"
+
+// Upper bound on the buckets a worker keeps in its ring
+constexpr size_t DELTA_MAX_BUCKETS = 1 << 10;
+
+// Classic bucketed delta-stepping (Meyer and Sanders). Light edges (w <=
+// delta) are relaxed until the current bucket is empty, heavy edges only once
+// per settled vertex. Buckets are kept per worker and merged when a bucket is
+// taken as the next frontier. While bucket cur is processed every new
+// distance falls into buckets cur .. cur + max_w / delta + 1, so each worker
+// keeps a ring of that many buckets, capped at DELTA_MAX_BUCKETS; vertices
+// beyond the ring wait in an overflow list that refills it when it runs dry.
+class DeltaStepping : public SSSPSolver {
+ private:
+  // Copy of the adjacency lists with every list partitioned into light and
+  // heavy edges: light edges of u are edge[G.offset[u], split[u]), heavy
+  // edges are edge[split[u], G.offset[u + 1])
+  struct LightHeavy {
+    sequence<Edge> edge;
+    sequence<EdgeId> split;
+  };
+
+  const Graph &G;
+  EdgeTy delta;
+  // built once per graph and delta, shared with the clones
+  std::shared_ptr<const LightHeavy> lh;
+  size_t num_buckets;
+  // first bucket of the ring, bucket b is bins[w][b % num_buckets]
+  size_t cur;
+  sequence<EdgeTy> dist;
+  sequence<uint32_t> settled;
+  std::vector<NodeId> frontier;
+  // bins[w][b] holds the vertices worker w moved into bucket b
+  std::vector<std::vector<std::vector<NodeId>>> bins;
+  // vertices and distances worker w pushed beyond the ring
+  std::vector<std::vector<std::pair<NodeId, EdgeTy>>> overflow;
+  // smallest bucket in overflow[w], stale entries included
+  std::vector<size_t> spill_min;
+  // vertices settled by worker w in the current bucket
+  std::vector<std::vector<NodeId>> done;
+  SSSPMetrics *metrics;
+
+  void push(NodeId v, EdgeTy d) {
+    size_t b = d / delta;
+    if (b < cur + num_buckets) {
+      bins[worker_id()][b % num_buckets].push_back(v);
+    } else {
+      overflow[worker_id()].emplace_back(v, d);
+      spill_min[worker_id()] = min(spill_min[worker_id()], b);
+    }
+    if (metrics) {
+      metrics->log_node_add(v);
+    }
+  }
+
+  static std::shared_ptr<const LightHeavy> partition(const Graph &G,
+                                                     EdgeTy delta) {
+    auto out = std::make_shared<LightHeavy>();
+    out->edge = sequence<Edge>(G.m);
+    out->split = sequence<EdgeId>(G.n);
+    parallel_for(0, G.n, [&](size_t u) {
+      auto first = out->edge.begin() + G.offset[u];
+      std::copy(G.edge.begin() + G.offset[u], G.edge.begin() + G.offset[u + 1],
+                first);
+      auto mid = std::partition(first, out->edge.begin() + G.offset[u + 1],
+                                [&](const Edge &e) { return e.w <= delta; });
+      out->split[u] = mid - out->edge.begin();
+    });
+    return out;
+  }
+
+  // Relaxes the light or the heavy edges of u
+  void relax_edges(NodeId u, bool heavy) {
+    EdgeId _s = heavy ? lh->split[u] : G.offset[u];
+    EdgeId _e = heavy ? G.offset[u + 1] : lh->split[u];
+    if (metrics) {
+      metrics->log_node_relax(u, _e - _s);
+    }
+    EdgeTy du = dist[u];
+    for (EdgeId es = _s; es < _e; es++) {
+      NodeId v = lh->edge[es].v;
+      EdgeTy nd = du + lh->edge[es].w;
+      if (write_min(&dist[v], nd, [](EdgeTy w1, EdgeTy w2) { return w1 < w2; })) {
+        push(v, nd);
+      }
+    }
+  }
+
+  // Moves cur to the smallest non-empty bucket after it over all workers,
+  // refilling the ring from the overflow lists once they may hold that
+  // bucket. Returns the new bucket, SIZE_MAX if there is none
+  size_t next_bucket() {
+    size_t nxt = SIZE_MAX;
+    for (size_t b = cur + 1; b < cur + num_buckets && nxt == SIZE_MAX; b++) {
+      for (auto &my_bins : bins) {
+        if (!my_bins[b % num_buckets].empty()) {
+          nxt = b;
+          break;
+        }
+      }
+    }
+    size_t spill = *std::min_element(spill_min.begin(), spill_min.end());
+    if (spill >= nxt) {
+      cur = nxt;
+      return cur;
+    }
+    // entries whose distance improved since they were pushed are stale
+    size_t nw = overflow.size();
+    std::vector<size_t> first(nw, SIZE_MAX);
+    parallel_for(0, nw, [&](size_t w) {
+      auto &list = overflow[w];
+      list.erase(std::remove_if(list.begin(), list.end(),
+                                [&](const std::pair<NodeId, EdgeTy> &p) {
+                                  return dist[p.first] != p.second;
+                                }),
+                 list.end());
+      for (auto &p : list) {
+        first[w] = min<size_t>(first[w], p.second / delta);
+      }
+    }, 1);
+    cur = min(nxt, *std::min_element(first.begin(), first.end()));
+    if (cur == SIZE_MAX) {
+      return SIZE_MAX;
+    }
+    // the ring only holds buckets from cur on, the window can move up to it
+    parallel_for(0, nw, [&](size_t w) {
+      auto &list = overflow[w];
+      size_t kept = 0;
+      spill_min[w] = SIZE_MAX;
+      for (auto &p : list) {
+        size_t b = p.second / delta;
+        if (b < cur + num_buckets) {
+          bins[w][b % num_buckets].push_back(p.first);
+        } else {
+          list[kept++] = p;
+          spill_min[w] = min(spill_min[w], b);
+        }
+      }
+      list.resize(kept);
+    }, 1);
+    return cur;
+  }
+
+  static size_t ring_size(const Graph &G, EdgeTy delta) {
+    EdgeTy max_w = reduce(
+        dseq(G.m, [&](size_t i) { return G.edge[i].w; }),
+        monoid([](EdgeTy a, EdgeTy b) { return max(a, b); }, (EdgeTy)0));
+    return min<size_t>(max_w / delta + 2, DELTA_MAX_BUCKETS);
+  }
+
+  // Moves bucket b of every worker into the frontier
+  void gather(size_t b) {
+    size_t nw = bins.size();
+    b %= num_buckets;
+    std::vector<size_t> start(nw + 1, 0);
+    for (size_t w = 0; w < nw; w++) {
+      start[w + 1] = start[w] + bins[w][b].size();
+    }
+    frontier.resize(start[nw]);
+    parallel_for(0, nw, [&](size_t w) {
+      std::copy(bins[w][b].begin(), bins[w][b].end(),
+                frontier.begin() + start[w]);
+      bins[w][b].clear();
+    }, 1);
+  }
+
+  DeltaStepping(const Graph &_G, EdgeTy _delta,
+                std::shared_ptr<const LightHeavy> _lh, size_t _num_buckets,
+                SSSPMetrics *_mets)
+      : G(_G), delta(_delta), lh(std::move(_lh)), num_buckets(_num_buckets),
+        cur(0), metrics(_mets) {
+    dist = sequence<EdgeTy>(G.n);
+    settled = sequence<uint32_t>(G.n);
+    bins.assign(num_workers(),
+                std::vector<std::vector<NodeId>>(num_buckets));
+    overflow.resize(num_workers());
+    spill_min.resize(num_workers());
+    done.resize(num_workers());
+  }
+
+ public:
+  DeltaStepping() = delete;
+  DeltaStepping(const Graph &_G, EdgeTy _delta, SSSPMetrics *_mets)
+      : DeltaStepping(_G, max<EdgeTy>(_delta, 1),
+                      partition(_G, max<EdgeTy>(_delta, 1)),
+                      ring_size(_G, max<EdgeTy>(_delta, 1)), _mets) {}
+
+  SSSPSolver *clone() const override {
+    return new DeltaStepping(G, delta, lh, num_buckets, nullptr);
+  }
+
+  size_t memory_bytes() const override {
+    size_t bytes = lh->edge.size() * sizeof(Edge) +
+                   lh->split.size() * sizeof(EdgeId) +
+                   dist.size() * sizeof(EdgeTy) +
+                   settled.size() * sizeof(uint32_t) +
+                   frontier.capacity() * sizeof(NodeId);
+    for (size_t w = 0; w < bins.size(); w++) {
+      for (auto &bin : bins[w]) {
+        bytes += sizeof(bin) + bin.capacity() * sizeof(NodeId);
+      }
+      bytes += overflow[w].capacity() * sizeof(std::pair<NodeId, EdgeTy>);
+      bytes += done[w].capacity() * sizeof(NodeId);
+    }
+    return bytes;
+  }
+
+  void sssp(int s, EdgeTy *_dist) override {
+    if (!G.weighted) {
+      fprintf(stderr, "Error: Input graph is unweighted\n");
+      exit(EXIT_FAILURE);
+    }
+    t_all.start();
+    parallel_for(0, G.n, [&](size_t i) {
+      dist[i] = INT_MAX / 2;
+      settled[i] = 0;
+    });
+    for (size_t w = 0; w < bins.size(); w++) {
+      for (auto &bin : bins[w]) {
+        bin.clear();
+      }
+      overflow[w].clear();
+      spill_min[w] = SIZE_MAX;
+    }
+    dist[s] = 0;
+    frontier.assign(1, s);
+    if (metrics) {
+      metrics->log_node_add(s);
+    }
+    cur = 0;
+    while (true) {
+      // light phase, vertices improved into the current bucket are
+      // relaxed again until the bucket stays empty
+      while (!frontier.empty()) {
+        parallel_for(0, frontier.size(), [&](size_t i) {
+          NodeId u = frontier[i];
+          if (dist[u] / delta != cur) {
+            // stale entry, dist[u] dropped into an earlier bucket after u
+            // was pushed here and u was relaxed from there
+            return;
+          }
+          if (!settled[u] && atomic_compare_and_swap(&settled[u], 0u, 1u)) {
+            done[worker_id()].push_back(u);
+          }
+          relax_edges(u, false);
+        });
+        gather(cur);
+        if (metrics) {
+          metrics->incAlgorithmStep();
+        }
+      }
+      // heavy phase, distances of the bucket are final now
+      parallel_for(0, done.size(), [&](size_t w) {
+        parallel_for(0, done[w].size(), [&](size_t i) {
+          relax_edges(done[w][i], true);
+        });
+      }, 1);
+      for (auto &my_done : done) {
+        my_done.clear();
+      }
+      if (next_bucket() == SIZE_MAX) {
+        break;
+      }
+      gather(cur);
+    }
+    t_all.stop();
+    parallel_for(0, G.n, [&](size_t i) { _dist[i] = dist[i]; });
+  }
+};
@@ -2,7 +2,7 @@
 #include <queue>
 
 #include "graph.hpp"
-void dijkstra(size_t s, const Graph &G, EdgeTy *dist) {
+inline void dijkstra(size_t s, const Graph &G, EdgeTy *dist) {
   fill(dist, dist + G.n, INT_MAX / 2);
   dist[s] = 0;
   priority_queue<pair<EdgeTy, NodeId>, vector<pair<EdgeTy, NodeId>>,
@@ -26,12 +26,7 @@ void dijkstra(size_t s, const Graph &G, EdgeTy *dist) {
   }
 }
 
-void verifier(size_t s, const Graph &G, EdgeTy *ch_dist) {
-  EdgeTy *cor_dist = new EdgeTy[G.n];
-  timer tm;
-  dijkstra(s, G, cor_dist);
-  tm.stop();
-  printf("dijkstra running time: %-10f\n", tm.get_total());
+inline void compare_dist(const Graph &G, EdgeTy *cor_dist, EdgeTy *ch_dist) {
   parallel_for(0, G.n, [&](size_t i) {
     if (cor_dist[i] != ch_dist[i]) {
       printf("dijkstra_dist[%zu]=%d, my_dist[%zu]=%d\n", i, cor_dist[i], i,
@@ -39,5 +34,56 @@ void verifier(size_t s, const Graph &G, EdgeTy *ch_dist) {
     }
     assert(cor_dist[i] == ch_dist[i]);
   });
+}
+
+inline void verifier(size_t s, const Graph &G, EdgeTy *ch_dist) {
+  EdgeTy *cor_dist = new EdgeTy[G.n];
+  timer tm;
+  dijkstra(s, G, cor_dist);
+  tm.stop();
+  printf("dijkstra running time: %-10f\n", tm.get_total());
+  compare_dist(G, cor_dist, ch_dist);
   delete[] cor_dist;
 }
+
+// Checks the labelling directly in O(m) parallel work instead of recomputing
+// it: dist[s] is 0, no edge can relax its target and every reached vertex
+// other than s has a tight incoming edge. For positive weights this
+// certifies shortest path distances, zero-weight cycles could carry labels
+// that are too small.
+inline void certificate_verifier(size_t s, const Graph &G, EdgeTy *ch_dist) {
+  constexpr EdgeTy INF = INT_MAX / 2;
+  constexpr size_t MAX_REPORT = 10;
+  timer tm;
+  sequence<uint8_t> tight(G.n), relaxable(G.n);
+  parallel_for(0, G.n, [&](size_t i) { tight[i] = relaxable[i] = 0; });
+  parallel_for(0, G.n, [&](size_t u) {
+    if (ch_dist[u] >= INF) return;
+    for (size_t j = G.offset[u]; j < G.offset[u + 1]; j++) {
+      NodeId v = G.edge[j].v;
+      EdgeTy d = ch_dist[u] + G.edge[j].w;
+      if (d < ch_dist[v]) {
+        relaxable[v] = 1;
+      } else if (d == ch_dist[v]) {
+        tight[v] = 1;
+      }
+    }
+  });
+  auto bad = filter(dseq(G.n, [](size_t i) { return (NodeId)i; }), [&](NodeId v) {
+    if (v == s) return ch_dist[v] != 0 || relaxable[v];
+    return relaxable[v] || (ch_dist[v] != INF && !tight[v]);
+  });
+  tm.stop();
+  printf("certificate verifier running time: %-10f\n", tm.get_total());
+  for (size_t i = 0; i < min(bad.size(), MAX_REPORT); i++) {
+    NodeId v = bad[i];
+    printf("my_dist[%u]=%u: %s\n", v, ch_dist[v],
+           v == s && ch_dist[v] != 0 ? "source is not 0"
+           : relaxable[v]            ? "an incoming edge is not relaxed"
+                                     : "no tight incoming edge");
+  }
+  if (bad.size()) {
+    printf("%zu vertices violate the certificate\n", bad.size());
+  }
+  assert(bad.size() == 0);
+}
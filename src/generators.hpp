@@ -0,0 +1,283 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "graph.hpp"
+
+// Synthetic inputs, built in parallel directly into the CSR of a Graph. A
+// spec is KIND:ARG:...[@SEED] and the same spec and seed always give the
+// same graph:
+//   rmat:SCALE:DEG[:A:B:C]  2^SCALE vertices, DEG * 2^SCALE R-MAT edges with
+//                           quadrant probabilities A, B, C (0.57 0.19 0.19)
+//   er:N:DEG                Erdos-Renyi, DEG * N uniformly random edges
+//   grid2d:X:Y              4-neighbor lattice
+//   grid3d:X:Y:Z            6-neighbor lattice
+//   geo:N:DEG               N random points in the unit square joined to all
+//                           points within the radius of expected degree DEG,
+//                           weighted by their distance (road-like)
+// Self-loops and duplicate edges are removed. rmat and er are directed
+// unless the Graph is symmetrized, then DEG counts both directions; the
+// others are always symmetric. Weights are uniform in [1, WEIGHT] except
+// for geo, and equal in both directions of an edge.
+constexpr uint64_t GEN_DEFAULT_SEED = 1;
+
+namespace generators {
+
+struct ListEdge {
+  NodeId u;
+  Edge e;
+};
+
+inline uint64_t random_u64(uint64_t seed, uint64_t i) {
+  return hash64(hash64(seed) + i);
+}
+// uniform in [0, 1)
+inline double random_unit(uint64_t seed, uint64_t i) {
+  return (random_u64(seed, i) >> 11) * 0x1.0p-53;
+}
+// Weight of the undirected pair {u, v}
+inline EdgeTy pair_weight(uint64_t seed, NodeId u, NodeId v) {
+  uint64_t key = (uint64_t)min(u, v) << 32 | max(u, v);
+  return (random_u64(seed ^ 0x5bd1e995, key) & (WEIGHT - 1)) + 1;
+}
+
+// Builds the CSR from any edge list, the list is consumed
+inline void build_from_list(Graph &G, size_t n, sequence<ListEdge> &list,
+                            bool symmetrize) {
+  if (symmetrize) {
+    size_t k = list.size();
+    sequence<ListEdge> both(2 * k);
+    parallel_for(0, k, [&](size_t i) {
+      both[i] = list[i];
+      both[k + i] = ListEdge{list[i].e.v, Edge(list[i].u, list[i].e.w)};
+    });
+    list = std::move(both);
+  }
+  sequence<EdgeId> degree(n + 1);
+  parallel_for(0, n + 1, [&](size_t i) { degree[i] = 0; });
+  parallel_for(0, list.size(), [&](size_t i) {
+    write_add(&degree[list[i].u], 1);
+  });
+  scan_inplace(degree.slice(),
+               monoid([](size_t a, size_t b) { return a + b; }, 0));
+  sequence<EdgeId> pos = degree;
+  sequence<Edge> edge(list.size());
+  parallel_for(0, list.size(), [&](size_t i) {
+    edge[fetch_and_add(&pos[list[i].u], 1)] = list[i].e;
+  });
+  // sort every neighborhood and keep the lightest copy of every edge
+  sequence<EdgeId> kept(n + 1);
+  kept[n] = 0;
+  parallel_for(0, n, [&](size_t u) {
+    quicksort(edge.slice(degree[u], degree[u + 1]),
+              [](Edge a, Edge b) { return a < b; });
+    size_t k = 0;
+    for (size_t j = degree[u]; j < degree[u + 1]; j++) {
+      if (edge[j].v != u && (j == degree[u] || edge[j].v != edge[j - 1].v)) {
+        k++;
+      }
+    }
+    kept[u] = k;
+  });
+  G.n = n;
+  G.m = scan_inplace(kept.slice(),
+                     monoid([](size_t a, size_t b) { return a + b; }, 0));
+  G.offset = std::move(kept);
+  G.offset[n] = G.m;
+  G.edge = sequence<Edge>(G.m);
+  parallel_for(0, n, [&](size_t u) {
+    size_t k = G.offset[u];
+    for (size_t j = degree[u]; j < degree[u + 1]; j++) {
+      if (edge[j].v != u && (j == degree[u] || edge[j].v != edge[j - 1].v)) {
+        G.edge[k++] = edge[j];
+      }
+    }
+  });
+}
+
+// Builds the CSR from a neighborhood function: neighbors(u, out) returns the
+// degree of u and, if out is not null, writes the neighbors to it in
+// increasing order
+template <class F>
+void build_from_neighbors(Graph &G, size_t n, F neighbors) {
+  G.n = n;
+  G.offset = sequence<EdgeId>(n + 1);
+  parallel_for(0, n, [&](size_t u) { G.offset[u] = neighbors(u, nullptr); });
+  G.offset[n] = 0;
+  G.m = scan_inplace(G.offset.slice(),
+                     monoid([](size_t a, size_t b) { return a + b; }, 0));
+  G.edge = sequence<Edge>(G.m);
+  parallel_for(0, n, [&](size_t u) {
+    neighbors(u, G.edge.begin() + G.offset[u]);
+  });
+}
+
+inline void rmat(Graph &G, uint64_t scale, double deg, double a, double b,
+                 double c, uint64_t seed) {
+  size_t n = (size_t)1 << scale;
+  size_t k = (size_t)(deg * n / (G.symmetrized ? 2 : 1));
+  sequence<ListEdge> list(k);
+  parallel_for(0, k, [&](size_t i) {
+    uint64_t u = 0, v = 0;
+    for (uint64_t l = 0; l < scale; l++) {
+      double r = random_unit(seed, i * scale + l);
+      u = u << 1 | (r >= a + b);
+      v = v << 1 | ((r >= a && r < a + b) || r >= a + b + c);
+    }
+    list[i] = ListEdge{(NodeId)u, Edge(v, pair_weight(seed, u, v))};
+  });
+  build_from_list(G, n, list, G.symmetrized);
+}
+
+inline void erdos_renyi(Graph &G, size_t n, double deg, uint64_t seed) {
+  size_t k = (size_t)(deg * n / (G.symmetrized ? 2 : 1));
+  sequence<ListEdge> list(k);
+  parallel_for(0, k, [&](size_t i) {
+    NodeId u = random_u64(seed, 2 * i) % n, v = random_u64(seed, 2 * i + 1) % n;
+    list[i] = ListEdge{u, Edge(v, pair_weight(seed, u, v))};
+  });
+  build_from_list(G, n, list, G.symmetrized);
+}
+
+// dims holds the side lengths, the last coordinate varies fastest
+inline void grid(Graph &G, const std::vector<size_t> &dims, uint64_t seed) {
+  size_t n = 1;
+  std::vector<size_t> stride(dims.size());
+  for (size_t d = dims.size(); d-- > 0;) {
+    stride[d] = n;
+    n *= dims[d];
+  }
+  build_from_neighbors(G, n, [&](size_t u, Edge *out) {
+    size_t k = 0;
+    auto add = [&](size_t v) {
+      if (out) {
+        out[k] = Edge(v, pair_weight(seed, u, v));
+      }
+      k++;
+    };
+    for (size_t d = 0; d < dims.size(); d++) {
+      if ((u / stride[d]) % dims[d] > 0) {
+        add(u - stride[d]);
+      }
+    }
+    for (size_t d = dims.size(); d-- > 0;) {
+      if ((u / stride[d]) % dims[d] + 1 < dims[d]) {
+        add(u + stride[d]);
+      }
+    }
+    return k;
+  });
+}
+
+inline void geometric(Graph &G, size_t n, double deg, uint64_t seed) {
+  double radius = std::sqrt(deg / (std::acos(-1.0) * n));
+  size_t side = max<size_t>(1, std::min(1.0 / radius, std::sqrt((double)n)));
+  size_t cells = side * side;
+  sequence<double> x(n), y(n);
+  sequence<EdgeId> cell_start(cells + 1);
+  parallel_for(0, cells + 1, [&](size_t i) { cell_start[i] = 0; });
+  auto cell = [&](double c) { return std::min<size_t>(c * side, side - 1); };
+  parallel_for(0, n, [&](size_t i) {
+    x[i] = random_unit(seed, 2 * i);
+    y[i] = random_unit(seed, 2 * i + 1);
+    write_add(&cell_start[cell(x[i]) * side + cell(y[i])], 1);
+  });
+  scan_inplace(cell_start.slice(),
+               monoid([](size_t a, size_t b) { return a + b; }, 0));
+  sequence<EdgeId> pos = cell_start;
+  sequence<NodeId> in_cell(n);
+  parallel_for(0, n, [&](size_t i) {
+    in_cell[fetch_and_add(&pos[cell(x[i]) * side + cell(y[i])], 1)] = i;
+  });
+  build_from_neighbors(G, n, [&](size_t u, Edge *out) {
+    size_t cx = cell(x[u]), cy = cell(y[u]), k = 0;
+    for (size_t i = cx ? cx - 1 : 0; i <= min(cx + 1, side - 1); i++) {
+      for (size_t j = cy ? cy - 1 : 0; j <= min(cy + 1, side - 1); j++) {
+        size_t c = i * side + j;
+        for (size_t p = cell_start[c]; p < cell_start[c + 1]; p++) {
+          NodeId v = in_cell[p];
+          double dist = std::hypot(x[u] - x[v], y[u] - y[v]);
+          if (v != u && dist <= radius) {
+            if (out) {
+              out[k] = Edge(v, 1 + (EdgeTy)(dist / radius * (WEIGHT - 1)));
+            }
+            k++;
+          }
+        }
+      }
+    }
+    if (out) {
+      sort(out, out + k);
+    }
+    return k;
+  });
+}
+
+}  // namespace generators
+
+// Fills G from a spec as described above, exits on malformed specs
+inline void generate_graph(Graph &G, const std::string &spec) {
+  std::string body = spec;
+  uint64_t seed = GEN_DEFAULT_SEED;
+  size_t at = body.find('@');
+  if (at != std::string::npos) {
+    seed = strtoull(body.c_str() + at + 1, nullptr, 10);
+    body = body.substr(0, at);
+  }
+  std::vector<std::string> f;
+  size_t start = 0, colon;
+  while ((colon = body.find(':', start)) != std::string::npos) {
+    f.push_back(body.substr(start, colon - start));
+    start = colon + 1;
+  }
+  f.push_back(body.substr(start));
+  auto num = [&](size_t i) { return atof(f[i].c_str()); };
+  auto count = [&](size_t i) { return (size_t)strtoull(f[i].c_str(), nullptr, 10); };
+
+  bool ok = true;
+  if (f[0] == "rmat" && (f.size() == 3 || f.size() == 6)) {
+    double a = 0.57, b = 0.19, c = 0.19;
+    if (f.size() == 6) {
+      a = num(3), b = num(4), c = num(5);
+    }
+    ok = count(1) > 0 && count(1) < 32 && a + b + c <= 1;
+    if (ok) {
+      generators::rmat(G, count(1), num(2), a, b, c, seed);
+    }
+  } else if (f[0] == "er" && f.size() == 3) {
+    ok = count(1) > 0 && count(1) < UINT32_MAX;
+    if (ok) {
+      generators::erdos_renyi(G, count(1), num(2), seed);
+    }
+  } else if ((f[0] == "grid2d" && f.size() == 3) ||
+             (f[0] == "grid3d" && f.size() == 4)) {
+    std::vector<size_t> dims;
+    double n = 1;
+    for (size_t i = 1; i < f.size(); i++) {
+      dims.push_back(count(i));
+      n *= dims.back();
+    }
+    ok = n >= 1 && n < UINT32_MAX;
+    if (ok) {
+      generators::grid(G, dims, seed);
+      G.symmetrized = true;
+    }
+  } else if (f[0] == "geo" && f.size() == 3) {
+    ok = count(1) > 0 && count(1) < UINT32_MAX && num(2) > 0;
+    if (ok) {
+      generators::geometric(G, count(1), num(2), seed);
+      G.symmetrized = true;
+    }
+  } else {
+    ok = false;
+  }
+  if (!ok) {
+    fprintf(stderr, "Error: Bad generator spec %s, expected one of rmat:SCALE:DEG[:A:B:C], er:N:DEG, "
+            "grid2d:X:Y, grid3d:X:Y:Z, geo:N:DEG, optionally followed by @SEED\n", spec.c_str());
+    exit(EXIT_FAILURE);
+  }
+  G.weighted = true;
+}
@@ -61,6 +61,14 @@ class Graph {
       }
     });
   }
+  void generate_unit_weight() {
+    if (weighted) {
+      fprintf(stderr, "Warning: Overwrite original weight\n");
+    } else {
+      weighted = true;
+    }
+    parallel_for(0, m, [&](size_t i) { edge[i].w = 1; });
+  }
   void exponential_generate_weight() {
     if (weighted) {
       fprintf(stderr, "Warning: Overwrite original weight\n");
@@ -248,6 +256,23 @@ class Graph {
       exit(EXIT_FAILURE);
     }
   }
+  // Picks the writer by the file extension like read_graph
+  void write_graph(char const* filename) {
+    string name = filename;
+    size_t idx = name.find_last_of('.');
+    string subfix = idx == string::npos ? "" : name.substr(idx + 1);
+    if (subfix == "adj") {
+      write_pbbs_format(filename);
+    } else if (subfix == "wsg") {
+      write_gapbs_format(filename);
+    } else if (subfix == "gr") {
+      write_galois_format(filename);
+    } else {
+      fprintf(stderr, "Error: Cannot write %s, use .adj, .wsg or .gr\n",
+              filename);
+      exit(EXIT_FAILURE);
+    }
+  }
   void write_pbbs_format(char const* filename) {
     printf("Info: Writing pbbs format\n");
     FILE* fp = fopen(filename, "w");
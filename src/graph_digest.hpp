@@ -0,0 +1,77 @@
+#pragma once
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+
+#include <cstdio>
+#include <string>
+
+#include "graph.hpp"
+
+// Bytes of the CSR arrays hashed per leaf of graph_digest
+constexpr size_t GRAPH_DIGEST_CHUNK = 1 << 22;
+
+inline std::string digest_hex(const unsigned char *digest, size_t len) {
+  static const char *hex = "0123456789abcdef";
+  std::string s(2 * len, '0');
+  for (size_t i = 0; i < len; i++) {
+    s[2 * i] = hex[digest[i] >> 4];
+    s[2 * i + 1] = hex[digest[i] & 15];
+  }
+  return s;
+}
+
+// Identity of a graph that does not depend on the file format it was read
+// from: the offset and edge arrays are cut into GRAPH_DIGEST_CHUNK byte
+// leaves that are hashed with SHA1 in parallel, and the digest is the SHA1
+// of n, m and the leaf digests. Has to be taken before edge weights are
+// generated, unweighted inputs hash with all weights 0.
+inline std::string graph_digest(const Graph &G) {
+  const unsigned char *arrays[2] = {
+      reinterpret_cast<const unsigned char *>(G.offset.begin()),
+      reinterpret_cast<const unsigned char *>(G.edge.begin())};
+  size_t bytes[2] = {(G.n + 1) * sizeof(EdgeId), G.m * sizeof(Edge)};
+  size_t leaves[2];
+  for (int a = 0; a < 2; a++) {
+    leaves[a] = (bytes[a] + GRAPH_DIGEST_CHUNK - 1) / GRAPH_DIGEST_CHUNK;
+  }
+  size_t total = leaves[0] + leaves[1];
+  std::string tree = "sssp-csr-v1 " + std::to_string(G.n) + " " +
+                     std::to_string(G.m) + "\n";
+  size_t header = tree.size();
+  tree.resize(header + total * SHA_DIGEST_LENGTH);
+  unsigned char *out = reinterpret_cast<unsigned char *>(&tree[header]);
+  parallel_for(0, total, [&](size_t i) {
+    int a = i >= leaves[0];
+    size_t first = (i - a * leaves[0]) * GRAPH_DIGEST_CHUNK;
+    size_t len = min(GRAPH_DIGEST_CHUNK, bytes[a] - first);
+    SHA1(arrays[a] + first, len, out + i * SHA_DIGEST_LENGTH);
+  }, 1);
+  unsigned char root[SHA_DIGEST_LENGTH];
+  SHA1(reinterpret_cast<const unsigned char *>(tree.data()), tree.size(),
+       root);
+  return digest_hex(root, SHA_DIGEST_LENGTH);
+}
+
+// SHA1 of the file contents, read in chunks. This is how graphs were
+// identified before graph_digest, only .adj files were supported then.
+// Returns an empty string if the file cannot be read.
+inline std::string file_digest(const char *path) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp) {
+    return "";
+  }
+  EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+  EVP_DigestInit_ex(ctx, EVP_sha1(), nullptr);
+  std::vector<char> buf(GRAPH_DIGEST_CHUNK);
+  size_t k;
+  while ((k = fread(buf.data(), 1, buf.size(), fp)) > 0) {
+    EVP_DigestUpdate(ctx, buf.data(), k);
+  }
+  bool ok = !ferror(fp);
+  fclose(fp);
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int len = 0;
+  EVP_DigestFinal_ex(ctx, digest, &len);
+  EVP_MD_CTX_free(ctx);
+  return ok ? digest_hex(digest, len) : "";
+}
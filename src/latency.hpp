@@ -0,0 +1,117 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Values below 2^LATENCY_SUB_BITS ns are exact, larger ones fall into
+// buckets of relative width 2^-(LATENCY_SUB_BITS-1)
+constexpr int LATENCY_SUB_BITS = 8;
+
+// Log-linear histogram of latencies in the spirit of HdrHistogram: every
+// power of two range is split into 2^(LATENCY_SUB_BITS-1) equal buckets, so
+// percentiles are within 0.8% of the exact value at a fixed 60KB for the
+// whole range of uint64_t nanoseconds. Recording is O(1) and not thread-safe.
+class LatencyHistogram {
+ private:
+  static constexpr uint64_t SUB = 1ULL << LATENCY_SUB_BITS;
+  static constexpr uint64_t HALF = SUB / 2;
+  std::vector<uint64_t> counts;
+  uint64_t total;
+  uint64_t min_ns, max_ns;
+  double sum_ns;
+
+  static size_t bucket(uint64_t v) {
+    if (v < SUB) {
+      return v;
+    }
+    int shift = 63 - __builtin_clzll(v) - (LATENCY_SUB_BITS - 1);
+    return SUB + (shift - 1) * HALF + ((v >> shift) - HALF);
+  }
+  // Largest value that falls into bucket b
+  static uint64_t bucket_high(size_t b) {
+    if (b < SUB) {
+      return b;
+    }
+    uint64_t k = b - SUB;
+    int shift = k / HALF + 1;
+    uint64_t top = k % HALF + HALF;
+    return ((top + 1) << shift) - 1;
+  }
+
+ public:
+  LatencyHistogram()
+      : counts(bucket(UINT64_MAX) + 1, 0),
+        total(0),
+        min_ns(UINT64_MAX),
+        max_ns(0),
+        sum_ns(0) {}
+
+  void record(double seconds) {
+    uint64_t ns = seconds > 0 ? (uint64_t)(seconds * 1e9) : 0;
+    counts[bucket(ns)]++;
+    total++;
+    min_ns = std::min(min_ns, ns);
+    max_ns = std::max(max_ns, ns);
+    sum_ns += ns;
+  }
+
+  uint64_t count() const { return total; }
+  double sum() const { return sum_ns * 1e-9; }
+  double mean() const { return total ? sum_ns * 1e-9 / total : 0; }
+  double min() const { return total ? min_ns * 1e-9 : 0; }
+  double max() const { return max_ns * 1e-9; }
+
+  // Smallest recorded latency that at least p percent of the queries do not
+  // exceed, as the upper end of its bucket
+  double percentile(double p) const {
+    if (!total) {
+      return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t)(p / 100 * total + 0.5));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < counts.size(); b++) {
+      seen += counts[b];
+      if (seen >= rank) {
+        return std::min(bucket_high(b), max_ns) * 1e-9;
+      }
+    }
+    return max();
+  }
+
+  void print(const char *name) const {
+    printf("%s latency: p50 %fs, p90 %fs, p99 %fs, max %fs (%lu queries)\n",
+           name, percentile(50), percentile(90), percentile(99), max(),
+           count());
+  }
+
+  // JSON object with the count, mean, min, max and the usual percentiles
+  std::string json() const {
+    char buf[512];
+    snprintf(buf, sizeof(buf),
+             "{\"count\": %lu, \"mean_s\": %.9f, \"min_s\": %.9f, "
+             "\"p50_s\": %.9f, \"p90_s\": %.9f, \"p99_s\": %.9f, "
+             "\"p999_s\": %.9f, \"max_s\": %.9f}",
+             count(), mean(), min(), percentile(50), percentile(90),
+             percentile(99), percentile(99.9), max());
+    return buf;
+  }
+};
+
+inline std::string json_string(const std::string &s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if ((unsigned char)c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += c;
+    }
+  }
+  return out + "\"";
+}
@@ -0,0 +1,34 @@
+#include "libsssp.hpp"
+
+#include <cstring>
+
+// Indexed by Algorithm
+static const char *ALGORITHM_NAMES[] = {"rho-stepping",          "delta-stepping",
+                                        "bellman-ford",          "bucket-delta-stepping",
+                                        "radius-stepping",       "bfs"};
+
+bool parse_algorithm(const char *name, Algorithm &algo) {
+  for (int i = rho_stepping; i <= bfs; i++) {
+    if (!strcmp(name, ALGORITHM_NAMES[i])) {
+      algo = static_cast<Algorithm>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *algorithm_name(Algorithm algo) { return ALGORITHM_NAMES[algo]; }
+
+SSSPSolver *create_solver(const Graph &G, Algorithm algo,
+                          const SolverOptions &opt, SSSPMetrics *metrics) {
+  if (algo == bucket_delta_stepping) {
+    return new DeltaStepping(G, opt.param, metrics);
+  } else if (algo == bfs) {
+    return new BFS(G, metrics);
+  } else if (algo == radius_stepping) {
+    return new RadiusStepping(G, opt.param, opt.cache_path, metrics);
+  }
+  SSSP *stepping = new SSSP(G, algo, metrics, opt.param);
+  stepping->set_prefetch_distance(opt.prefetch_dist);
+  return stepping;
+}
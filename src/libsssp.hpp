@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+
+#include "bfs.hpp"
+#include "delta_stepping.hpp"
+#include "radius_stepping.hpp"
+#include "sssp.h"
+
+// Stable C++ entry point of libsssp. Solvers only reference the graph they
+// were created for and keep all of their state (buffers, sampling seeds,
+// timers) per instance, so any number of them can run in one process as long
+// as each instance is used by one caller at a time.
+
+struct SolverOptions {
+  // delta, rho or the ball size of radius-stepping
+  size_t param = 1 << 21;
+  size_t prefetch_dist = PREFETCH_DISTANCE;
+  // Where radius-stepping caches its shortcuts, empty disables the cache
+  std::string cache_path;
+};
+
+// Parses the names accepted by -a, returns false for unknown names
+bool parse_algorithm(const char *name, Algorithm &algo);
+const char *algorithm_name(Algorithm algo);
+
+// The caller owns the returned solver
+SSSPSolver *create_solver(const Graph &G, Algorithm algo,
+                          const SolverOptions &opt,
+                          SSSPMetrics *metrics = nullptr);
@@ -0,0 +1,605 @@
+#include <numeric>
+#include <regex>
+
+#include "generators.hpp"
+#include "graph_digest.hpp"
+#include "latency.hpp"
+#include "libsssp.hpp"
+#include "output.hpp"
+#include "sequential.hpp"
+#include "server.hpp"
+#include "throughput.hpp"
+#include "backend/sqlite3_backend.hpp"
+#include "backend/postgres_backend.hpp"
+#include "backend/columnar_backend.hpp"
+
+using namespace std;
+using namespace pbbs;
+
+// Taken from: https://stackoverflow.com/questions/874134/find-out-if-string-ends-with-another-string-in-c
+// All credit belongs to Joseph and tshepang
+inline bool ends_with(std::string const &value, std::string const &ending)
+{
+  if (ending.size() > value.size())
+    return false;
+  return std::equal(ending.rbegin(), ending.rend(), value.rbegin());
+}
+
+inline bool starts_with(std::string const &value, std::string const &beginning)
+{
+  if (beginning.size() > value.size())
+    return false;
+  return std::equal(beginning.begin(), beginning.end(), value.begin());
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc == 1)
+  {
+    fprintf(
+        stderr,
+        "Usage: %s [-i input_file] [-p parameter] [-m metrics_file] [-w] [-s] [-v] [-V] [-a "
+        "algorithm]\n"
+        "Options:\n"
+        "\t-i,\tinput file path, or gen:SPEC for a synthetic graph: "
+        "rmat:SCALE:DEG[:A:B:C], er:N:DEG, grid2d:X:Y, grid3d:X:Y:Z, "
+        "geo:N:DEG, each optionally followed by @SEED\n"
+        "\t-W,\twrite the input graph to a .adj, .wsg or .gr file\n"
+        "\t-m,\tmetrics: sqlite:PATH, postgres:user:pw@host:port/db or "
+        "columnar:PATH\n"
+        "\t-R,\twith -m, track only about one of every R vertices\n"
+        "\t-p,\tparameter(e.g. delta, rho, ball size of radius-stepping)\n"
+        "\t-w,\tweighted input graph\n"
+        "\t-s,\tsymmetrized input graph\n"
+        "\t-v,\tverify result with a parallel certificate check\n"
+        "\t-V,\tverify result against a serial Dijkstra (slow)\n"
+        "\t-b,\tsequential baseline to time and verify against: [dijkstra] "
+        "[radix-heap] [dial] [dary-heap]\n"
+        "\t-r,\tnum rounds per source vertex\n"
+        "\t-f,\tprefetch distance in edges, 0 disables prefetching\n"
+        "\t-t,\tthroughput mode, run the sources concurrently and report queries/s\n"
+        "\t-j,\twrite the latency percentiles and throughput to a JSON file\n"
+        "\t-o,\twrite the distances of every source to PREFIX.SOURCE.dist\n"
+        "\t-z,\twith -o, write compressed PREFIX.SOURCE.distz files instead\n"
+        "\t-P,\tcount instructions, cycles, cache and dTLB misses per query, "
+        "-PP also per relax and pack phase\n"
+        "\t-T,\ttrace the phases of every round to PREFIX.csv and PREFIX.json\n"
+        "\t-S,\tserve queries on a Unix domain socket, - for stdin/stdout\n"
+        "\t-n,\tnum source vertices per graph\n"
+        "\t-a,\talgorithm: [rho-stepping] [delta-stepping] [bellman-ford] "
+        "[bucket-delta-stepping] [radius-stepping] [bfs]\n"
+				"\t-g,\tregime: additional information\n",
+        argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  int c;
+  char const *FILEPATH = nullptr;
+  bool weighted = false;
+  bool symmetrized = false;
+  bool verify = false;
+  bool verify_dijkstra = false;
+  const char *BASELINE = nullptr;
+  bool throughput = false;
+  const char *SOCKET_PATH = nullptr;
+  const char *OUTPUT_PREFIX = nullptr;
+  const char *TRACE_PREFIX = nullptr;
+  const char *JSON_PATH = nullptr;
+  const char *WRITE_PATH = nullptr;
+  // -P counts per query, -PP also per relax and pack phase
+  int count_perf = 0;
+  bool compress_output = false;
+  Baseline baseline_kind = binary_heap;
+  std::string METRICS_PATH;
+  unsigned long SAMPLE_RATE = 1;
+  int NUM_SOURCES = 1000;
+  int NUM_ROUNDS = 10;
+
+  size_t param = 1 << 21;
+  bool param_given = false;
+  size_t prefetch_dist = PREFETCH_DISTANCE;
+  Algorithm algo = rho_stepping;
+  const char *ALGORITHM = algorithm_name(algo);
+	const char *REGIME = "unspecified";
+  while ((c = getopt(argc, argv, "i:p:g:a:n:r:m:R:f:b:S:o:T:j:W:wsvVtzP")) != -1)
+  {
+    switch (c)
+    {
+    case 'i':
+      FILEPATH = optarg;
+      break;
+    case 'p':
+      param = atol(optarg);
+      param_given = true;
+      break;
+    case 'n':
+      NUM_SOURCES = atol(optarg);
+      break;
+		case 'g':
+			REGIME = optarg;
+			break;
+    case 'r':
+      NUM_ROUNDS = atol(optarg);
+      break;
+    case 'f':
+      prefetch_dist = atol(optarg);
+      break;
+    case 'a':
+      if (!parse_algorithm(optarg, algo))
+      {
+        fprintf(stderr, "Error: Unknown algorithm %s\n", optarg);
+        exit(EXIT_FAILURE);
+      }
+      ALGORITHM = optarg;
+      break;
+    case 'w':
+      weighted = true;
+      break;
+    case 's':
+      symmetrized = true;
+      break;
+    case 'v':
+      verify = true;
+      break;
+    case 'V':
+      verify_dijkstra = true;
+      break;
+    case 't':
+      throughput = true;
+      break;
+    case 'S':
+      SOCKET_PATH = optarg;
+      break;
+    case 'o':
+      OUTPUT_PREFIX = optarg;
+      break;
+    case 'z':
+      compress_output = true;
+      break;
+    case 'T':
+      TRACE_PREFIX = optarg;
+      break;
+    case 'W':
+      WRITE_PATH = optarg;
+      break;
+    case 'j':
+      JSON_PATH = optarg;
+      break;
+    case 'P':
+      count_perf++;
+      break;
+    case 'b':
+      if (!strcmp(optarg, "dijkstra"))
+      {
+        baseline_kind = binary_heap;
+      }
+      else if (!strcmp(optarg, "radix-heap"))
+      {
+        baseline_kind = radix_heap;
+      }
+      else if (!strcmp(optarg, "dial"))
+      {
+        baseline_kind = dial;
+      }
+      else if (!strcmp(optarg, "dary-heap"))
+      {
+        baseline_kind = dary_heap;
+      }
+      else
+      {
+        fprintf(stderr, "Error: Unknown baseline %s\n", optarg);
+        exit(EXIT_FAILURE);
+      }
+      BASELINE = optarg;
+      break;
+    case 'm':
+      METRICS_PATH = optarg;
+      break;
+    case 'R':
+      SAMPLE_RATE = atol(optarg);
+      break;
+    default:
+      fprintf(stderr, "Error: Unknown option %c\n", optopt);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if ((throughput || SOCKET_PATH) && (METRICS_PATH != "" || TRACE_PREFIX))
+  {
+    fprintf(stderr, "Error: -m and -T record single queries, they cannot be "
+                    "combined with -t or -S\n");
+    exit(EXIT_FAILURE);
+  }
+  int reply_fd = STDOUT_FILENO;
+  if (SOCKET_PATH && !strcmp(SOCKET_PATH, "-"))
+  {
+    // the replies own stdout, all diagnostics from here on go to stderr
+    reply_fd = reserve_stdout();
+  }
+  Graph G(weighted, symmetrized);
+
+  if (starts_with(FILEPATH, "gen:"))
+  {
+    printf("Info: Generating graph %s\n", FILEPATH + 4);
+    timer gen_tm;
+    generate_graph(G, FILEPATH + 4);
+    printf("Info: Generated %zu vertices and %zu edges in %.3fs\n", G.n, G.m,
+           gen_tm.get_total());
+    weighted = true;
+  }
+  else
+  {
+    printf("Info: Reading graph\n");
+    G.read_graph(FILEPATH);
+  }
+  if (WRITE_PATH)
+  {
+    // before weights are generated, so the file holds the graph as it was read
+    G.write_graph(WRITE_PATH);
+  }
+  std::vector<std::string> digests;
+  if ((METRICS_PATH != "" && !starts_with(METRICS_PATH, "columnar:")) ||
+      JSON_PATH)
+  {
+    // before weights are generated, so every format of a graph gets the same
+    // digest; .adj files are also looked up by their legacy text digest.
+    // The JSON report carries it so results can be joined with the metrics
+    timer digest_tm;
+    digests.push_back(graph_digest(G));
+    if (METRICS_PATH != "" && ends_with(FILEPATH, ".adj"))
+    {
+      digests.push_back(file_digest(FILEPATH));
+    }
+    printf("Info: Graph digest %s (%.3fs)\n", digests[0].c_str(),
+           digest_tm.get_total());
+  }
+  if (algo == bfs)
+  {
+    // hop distances, unit weights let the verifier compare them directly
+    G.generate_unit_weight();
+  }
+  else if (!weighted)
+  {
+    printf("Info: Generating edge weights\n");
+    G.generate_weight();
+    //G.exponential_generate_weight();
+  }
+
+  SSSPMetrics *metrics_ptr = nullptr;
+  if (METRICS_PATH != "")
+  {
+    BackendInterface *backend = nullptr;
+    if (starts_with(METRICS_PATH, "columnar:"))
+    {
+      // the file only describes the run, it does not need the graph digest
+      METRICS_PATH = METRICS_PATH.substr(strlen("columnar:"));
+      backend = new ColumnarBackend(METRICS_PATH, G.n, ALGORITHM, param, REGIME);
+    }
+    else if (starts_with(METRICS_PATH, "sqlite:"))
+    {
+      METRICS_PATH = METRICS_PATH.substr(strlen("sqlite:"));
+      backend = new Sqlite3Backend(METRICS_PATH, digests, ALGORITHM, param, REGIME);
+    }
+    else if (starts_with(METRICS_PATH, "postgres:"))
+    {
+      std::regex re("postgres:(.*):(.*)@(.*):(.*)/(.*)");
+      std::cmatch m;
+      if (std::regex_match(METRICS_PATH.c_str(), m, re))
+      {
+        std::string user = m[1];
+        std::string password = m[2];
+        std::string host = m[3];
+        int port = std::atoi(m[4].str().c_str());
+        std::string database = m[5];
+        backend = new PostgresBackend(user, password, host, port, database, digests, ALGORITHM, param);
+      }
+      else
+      {
+        std::cerr << "The format does not conform to postgres. Format must be like: postgres:username:password@127.0.0.1:5432/database_name" << std::endl;
+        std::exit(-1);
+      }
+    }
+    else
+    {
+      std::cerr << "Fatal error: Only sqlite, postgres and columnar backends are supported." << std::endl;
+      std::exit(-1);
+    }
+
+    if (backend == nullptr)
+    {
+      std::cerr << "Could not initialise backend" << std::endl;
+      std::exit(-1);
+    }
+
+    metrics_ptr = new SSSPMetrics(backend, G.n, SAMPLE_RATE);
+  }
+
+  if (algo == radius_stepping && !param_given)
+  {
+    param = RADIUS_BALL;
+  }
+  SolverOptions options;
+  options.param = param;
+  options.prefetch_dist = prefetch_dist;
+  // generated graphs have no file to keep the shortcuts next to
+  if (algo == radius_stepping && !starts_with(FILEPATH, "gen:"))
+  {
+    options.cache_path = std::string(FILEPATH) + ".rs" + std::to_string(param);
+  }
+  SSSPSolver *solver = create_solver(G, algo, options, metrics_ptr);
+  printf("Info: Solver memory: %.1f MiB\n", solver->memory_bytes() / 1048576.0);
+  if (SOCKET_PATH)
+  {
+    QueryServer server(G, solver);
+    server.listen_on(SOCKET_PATH, reply_fd);
+    fprintf(stderr, "Info: Serving %s with %zu lanes on %s\n", FILEPATH,
+            server.lanes(), SOCKET_PATH);
+    server.serve();
+    delete solver;
+    return 0;
+  }
+  Tracer *tracer = nullptr;
+  if (SSSP *stepping = dynamic_cast<SSSP *>(solver))
+  {
+    printf("Info: Relax kernels: %s, prefetch distance: %zu\n",
+           stepping->kernel_name(), prefetch_dist);
+    if (TRACE_PREFIX)
+    {
+      tracer = new Tracer();
+      stepping->set_tracer(tracer);
+    }
+  }
+  else if (TRACE_PREFIX)
+  {
+    fprintf(stderr, "Warning: -T only traces rho-stepping, delta-stepping "
+                    "and bellman-ford\n");
+  }
+  // The workers exist once the graph has been read in parallel, the counters
+  // are opened on all of them
+  PerfCounters *perf = nullptr;
+  std::vector<PhaseCounters> perf_total;
+  if (count_perf && throughput)
+  {
+    fprintf(stderr, "Warning: -P counts single queries and is ignored with -t\n");
+  }
+  else if (count_perf)
+  {
+    perf = new PerfCounters();
+    printf("Info: Counting hardware events on %zu threads\n", perf->num_threads());
+    SSSP *stepping = dynamic_cast<SSSP *>(solver);
+    if (count_perf > 1 && stepping)
+    {
+      stepping->set_perf_counters(perf);
+    }
+    else if (count_perf > 1)
+    {
+      fprintf(stderr, "Warning: -PP only splits rho-stepping, delta-stepping "
+                      "and bellman-ford into phases\n");
+    }
+  }
+  printf("Running on %s: |V|=%zu, |E|=%zu, param=%zu, num_src=%d, "
+         "num_round=%d\n",
+         FILEPATH, G.n, G.m, param, NUM_SOURCES, NUM_ROUNDS);
+  EdgeTy *dijkstra_dist = new EdgeTy[G.n];
+  EdgeTy *my_dist = new EdgeTy[G.n];
+  SequentialSSSP *baseline = nullptr;
+  if (BASELINE)
+  {
+    baseline = new SequentialSSSP(G, baseline_kind);
+    if (baseline->queue_kind() != baseline_kind)
+    {
+      BASELINE = "radix-heap";
+    }
+  }
+  DistanceWriter *writer = nullptr;
+  if (OUTPUT_PREFIX)
+  {
+    writer = new DistanceWriter(OUTPUT_PREFIX, G.n, compress_output);
+  }
+
+  // every query, the warm-up ones are kept apart
+  LatencyHistogram latency, warmup_latency;
+  double wall_time = 0;
+  if (throughput)
+  {
+    ThroughputRunner runner(G, NUM_SOURCES, solver);
+    std::vector<NodeId> sources(NUM_SOURCES);
+    for (int v = 0; v < NUM_SOURCES; v++)
+    {
+      sources[v] = hash32(v) % G.n;
+    }
+    printf("Info: Throughput mode with %zu %s lanes\n", runner.lanes(),
+           runner.lanes() > 1 ? "inter-query" : "intra-query");
+    // warmup, its distances are the ones written with -o
+    ThroughputResult warm = runner.run(sources, [&](size_t i, const EdgeTy *dist)
+                                       {
+                                         if (writer)
+                                         {
+                                           writer->write(sources[i], dist);
+                                         }
+                                       });
+    for (double t : warm.latency)
+    {
+      warmup_latency.record(t);
+    }
+    double seconds = 0;
+    for (int i = 0; i < NUM_ROUNDS; i++)
+    {
+      ThroughputResult res = runner.run(sources);
+      seconds += res.seconds;
+      for (double t : res.latency)
+      {
+        latency.record(t);
+      }
+    }
+    wall_time = seconds;
+    printf("throughput: %f queries/s (%d queries in %fs)\n",
+           NUM_SOURCES * NUM_ROUNDS / seconds, NUM_SOURCES * NUM_ROUNDS, seconds);
+  }
+
+  double total_time = 0;
+  double baseline_time = 0;
+  for (int v = 0; !throughput && v < NUM_SOURCES; v++)
+  {
+    int s = hash32(v) % G.n;
+    // printf("Source: %d; Iteration: %d/%d\n", s,v+1,NUM_SOURCES);
+    // first time warmup
+    solver->reset_timer();
+    solver->sssp(s, my_dist);
+    warmup_latency.record(solver->t_all.get_total());
+    if (perf)
+    {
+      perf->take();
+    }
+    if (metrics_ptr)
+    {
+      metrics_ptr->reset_round();
+    }
+
+    for (int i = 0; i < NUM_ROUNDS; i++)
+    {
+      solver->reset_timer();
+      if (perf)
+      {
+        perf->start(perf_query);
+      }
+      solver->sssp(s, my_dist);
+      total_time += solver->t_all.get_total();
+      latency.record(solver->t_all.get_total());
+      if (perf)
+      {
+        perf->stop(perf_query);
+        std::vector<PhaseCounters> phases = perf->take();
+        for (auto &c : phases)
+        {
+          auto it = find_if(perf_total.begin(), perf_total.end(), [&](const PhaseCounters &t)
+                            { return t.phase == c.phase; });
+          if (it == perf_total.end())
+          {
+            perf_total.push_back(c);
+            continue;
+          }
+          it->seconds += c.seconds;
+          for (int e = 0; e < NUM_PERF_EVENTS; e++)
+          {
+            it->events[e] = c.events[e] < 0 ? -1 : it->events[e] + c.events[e];
+          }
+        }
+        if (metrics_ptr)
+        {
+          metrics_ptr->setPhaseCounters(phases);
+        }
+      }
+      if (metrics_ptr)
+      {
+        metrics_ptr->reset_round(s);
+      }
+
+      printf("Source %d; Iteration %d/%d: Round %d/%d: %fs                                 \r", s, v + 1, NUM_SOURCES, i + 1, NUM_ROUNDS, solver->t_all.get_total());
+      fflush(stdout);
+    }
+    if (writer)
+    {
+      writer->write(s, my_dist);
+    }
+    if (verify)
+    {
+      printf("Info: Running certificate verifier\n");
+      certificate_verifier(s, G, my_dist);
+    }
+    if (baseline)
+    {
+      baseline->reset_timer();
+      baseline->sssp(s, dijkstra_dist);
+      baseline_time += baseline->t_all.get_total();
+    }
+    if (verify_dijkstra && baseline)
+    {
+      printf("Info: Comparing with %s\n", BASELINE);
+      compare_dist(G, dijkstra_dist, my_dist);
+    }
+    else if (verify_dijkstra)
+    {
+      printf("Info: Running verifier\n");
+      verifier(s, G, my_dist);
+    }
+  }
+  printf("\n");
+  if (!throughput)
+  {
+    printf("average running time: %f\n", total_time / NUM_SOURCES / NUM_ROUNDS);
+    // one query at a time
+    wall_time = total_time;
+  }
+  latency.print("query");
+  warmup_latency.print("warm-up");
+  if (JSON_PATH)
+  {
+    FILE *json = fopen(JSON_PATH, "w");
+    if (!json)
+    {
+      fprintf(stderr, "Warning: Cannot write %s\n", JSON_PATH);
+    }
+    else
+    {
+      fprintf(json,
+              "{\"graph\": %s, \"n\": %lu, \"m\": %lu, \"algorithm\": %s, "
+              "\"parameter\": %zu, \"regime\": %s, \"digest\": %s, \"workers\": %d, "
+              "\"mode\": \"%s\", \"sources\": %d, \"rounds\": %d,\n"
+              " \"throughput_qps\": %f, \"measured\": %s,\n"
+              " \"warmup\": %s}\n",
+              json_string(FILEPATH).c_str(), G.n, G.m,
+              json_string(ALGORITHM).c_str(), param,
+              json_string(REGIME).c_str(),
+              json_string(digests.empty() ? "" : digests[0]).c_str(),
+              (int)num_workers(),
+              throughput ? "throughput" : "latency", NUM_SOURCES, NUM_ROUNDS,
+              wall_time > 0 ? latency.count() / wall_time : 0.0,
+              latency.json().c_str(), warmup_latency.json().c_str());
+      fclose(json);
+    }
+  }
+  if (baseline && !throughput)
+  {
+    double avg = baseline_time / NUM_SOURCES;
+    printf("%s average running time: %f, speedup: %f\n", BASELINE, avg,
+           avg / (total_time / NUM_SOURCES / NUM_ROUNDS));
+  }
+  for (auto &c : perf_total)
+  {
+    double queries = (double)NUM_SOURCES * NUM_ROUNDS;
+    printf("perf %s per query: %fs", c.phase.c_str(), c.seconds / queries);
+    for (int e = 0; e < NUM_PERF_EVENTS; e++)
+    {
+      if (c.events[e] >= 0)
+      {
+        printf(", %s %.0f", PERF_EVENT_NAMES[e], c.events[e] / queries);
+      }
+    }
+    printf("\n");
+  }
+  delete perf;
+  if (tracer)
+  {
+    std::string prefix = TRACE_PREFIX;
+    if (!tracer->write_csv(prefix + ".csv") ||
+        !tracer->write_chrome(prefix + ".json"))
+    {
+      fprintf(stderr, "Warning: Cannot write trace %s\n", TRACE_PREFIX);
+    }
+    printf("Info: Traced %zu phases (%zu older ones dropped) to %s.csv and "
+           "%s.json\n",
+           tracer->size(), tracer->dropped(), TRACE_PREFIX, TRACE_PREFIX);
+    delete tracer;
+  }
+  delete writer;
+  delete baseline;
+  delete[] dijkstra_dist;
+  delete[] my_dist;
+  delete solver;
+  if (metrics_ptr)
+  {
+    delete metrics_ptr;
+    metrics_ptr = nullptr;
+  }
+
+  return 0;
+}
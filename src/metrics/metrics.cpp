@@ -1,21 +1,175 @@
 #include "metrics.hpp"
+#include "stats.hpp"
 #include "../backend/backend_interface.hpp"
+#include <algorithm>
+#include <cilk/cilk_api.h>
 #include <iostream>
 
-SSSPMetrics::SSSPMetrics(BackendInterface *interface) : _backend(interface)
+namespace {
+// splitmix64 finalizer, spreads consecutive node ids over the sample classes
+inline unsigned long long mix(unsigned long long x)
 {
-    // At least one round is needed
-    _insertions_by_id.push_back({});
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+CounterStats counterStats(std::vector<unsigned long> values, unsigned long rate)
+{
+    VectorStats<unsigned long> stats(&values, 0, rate);
+    return CounterStats{values.size(), stats.sum(), stats.mean(), stats.median(), stats.first_quartile(), stats.third_quartile()};
+}
+}
+
+SSSPMetrics::SSSPMetrics(BackendInterface *interface, unsigned long long n, unsigned long rate) : _n(n), _rate(std::max(rate, 1UL)), _dropped(0), _backend(interface), _pending_bytes(0), _closing(false)
+{
+    if (_rate == 1)
+    {
+        _insertions_per_node.assign(n, 0);
+        _edge_relaxations_per_node.assign(n, 0);
+        _relaxed.assign(n, 0);
+        _step_stamp.assign(n, 0);
+    }
+    else
+    {
+        unsigned long long capacity = 64;
+        while (capacity < 2 * n / _rate)
+        {
+            capacity *= 2;
+        }
+        _samples.resize(capacity);
+    }
+    _stamp = 1;
+    _step_count.resize(__cilkrts_get_nworkers());
+    clearCounters();
+    _currentStep = 0;
+    if (_backend)
+    {
+        _writer = std::thread([this] { writeLoop(); });
+    }
+}
+
+void SSSPMetrics::writeLoop()
+{
+    auto lck = std::unique_lock<std::mutex>(_pending_guard);
+    while (true)
+    {
+        _pending_changed.wait(lck, [this] { return _closing || !_pending.empty(); });
+        if (_pending.empty())
+        {
+            return;
+        }
+        std::vector<MetricsSnapshot> batch;
+        while (!_pending.empty() && batch.size() < METRICS_BATCH)
+        {
+            _pending_bytes -= snapshotBytes(_pending.front());
+            batch.push_back(std::move(_pending.front()));
+            _pending.pop_front();
+        }
+        _pending_changed.notify_all();
+        lck.unlock();
+        _backend->dump(batch);
+        lck.lock();
+    }
+}
+
+bool SSSPMetrics::sampled(unsigned long long nodeId) const
+{
+    return _rate == 1 || mix(nodeId) % _rate == 0;
+}
+
+SSSPMetrics::SampleEntry *SSSPMetrics::sampleEntry(unsigned long long nodeId)
+{
+    size_t mask = _samples.size() - 1;
+    size_t pos = mix(nodeId ^ 0x9e3779b97f4a7c15ULL) & mask;
+    for (size_t probes = 0; probes <= mask; probes++, pos = (pos + 1) & mask)
+    {
+        unsigned long long key = __atomic_load_n(&_samples[pos].nodeId, __ATOMIC_ACQUIRE);
+        if (key == nodeId)
+        {
+            return &_samples[pos];
+        }
+        if (key == EMPTY_SLOT)
+        {
+            if (__atomic_compare_exchange_n(&_samples[pos].nodeId, &key, nodeId, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) || key == nodeId)
+            {
+                return &_samples[pos];
+            }
+        }
+    }
+    __atomic_fetch_add(&_dropped, 1, __ATOMIC_RELAXED);
+    return nullptr;
+}
+
+void SSSPMetrics::clearCounters()
+{
+    if (_rate == 1)
+    {
+        std::fill(_insertions_per_node.begin(), _insertions_per_node.end(), 0);
+        std::fill(_edge_relaxations_per_node.begin(), _edge_relaxations_per_node.end(), 0);
+        std::fill(_relaxed.begin(), _relaxed.end(), 0);
+    }
+    else
+    {
+        std::fill(_samples.begin(), _samples.end(), SampleEntry{EMPTY_SLOT, 0, 0, 0, 0});
+        if (_dropped)
+        {
+            std::cerr << "Warning: " << _dropped << " sampled nodes did not fit the metrics table" << std::endl;
+            _dropped = 0;
+        }
+    }
+}
+
+void SSSPMetrics::nextStamp()
+{
+    _stamp += 1;
+    if (_stamp == 0)
+    {
+        // Wrapped around, old stamps could collide with new ones
+        std::fill(_step_stamp.begin(), _step_stamp.end(), 0);
+        for (auto &entry : _samples)
+        {
+            entry.step_stamp = 0;
+        }
+        _stamp = 1;
+    }
+}
+
+unsigned long SSSPMetrics::currentStepCount()
+{
+    unsigned long sum = 0;
+    for (auto &count : _step_count)
+    {
+        sum += count.value;
+    }
+    return sum * _rate;
 }
 
 void SSSPMetrics::incAlgorithmStep()
 {
     _currentStep += 1;
-    _insertions_by_id.push_back({});
+    _insertions_per_step.push_back(currentStepCount());
+    for (auto &count : _step_count)
+    {
+        count.value = 0;
+    }
+    nextStamp();
 }
 
 SSSPMetrics::~SSSPMetrics()
 {
+    if (_writer.joinable())
+    {
+        {
+            auto lck = std::unique_lock<std::mutex>(_pending_guard);
+            _closing = true;
+        }
+        _pending_changed.notify_all();
+        _writer.join();
+    }
     if(_backend) {
         delete _backend;
         _backend = nullptr;
@@ -24,20 +178,72 @@ SSSPMetrics::~SSSPMetrics()
 
 int SSSPMetrics::getCurrentTotalCount()
 {
-    auto lck = std::unique_lock<std::mutex>(_access_guard);
-    return _insertions_by_id.back().size();
+    return currentStepCount();
+}
+
+unsigned long SSSPMetrics::getSampleRate() const
+{
+    return _rate;
 }
 
 void SSSPMetrics::log_node_add(unsigned long long nodeId)
 {
-    auto lck = std::unique_lock<std::mutex>(_access_guard);
-    _insertions_by_id.back().insert(nodeId);
-    _insertions_per_node[nodeId]+=1;
+    uint32_t *insertions, *step_stamp;
+    if (_rate == 1)
+    {
+        insertions = &_insertions_per_node[nodeId];
+        step_stamp = &_step_stamp[nodeId];
+    }
+    else
+    {
+        if (!sampled(nodeId))
+        {
+            return;
+        }
+        SampleEntry *entry = sampleEntry(nodeId);
+        if (!entry)
+        {
+            return;
+        }
+        insertions = &entry->insertions;
+        step_stamp = &entry->step_stamp;
+    }
+    __atomic_fetch_add(insertions, 1, __ATOMIC_RELAXED);
+    uint32_t old = __atomic_load_n(step_stamp, __ATOMIC_RELAXED);
+    if (old != _stamp &&
+        __atomic_compare_exchange_n(step_stamp, &old, _stamp, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+        _step_count[__cilkrts_get_worker_number()].value++;
+    }
 }
 
 void SSSPMetrics::log_node_relax(unsigned long long nodeId, unsigned long neighborhood_size) {
-    auto lck = std::unique_lock<std::mutex>(_access_guard);
-    _edge_relaxations_per_node[nodeId]+=neighborhood_size;
+    uint64_t *edge_relaxations;
+    uint8_t *relaxed;
+    if (_rate == 1)
+    {
+        edge_relaxations = &_edge_relaxations_per_node[nodeId];
+        relaxed = &_relaxed[nodeId];
+    }
+    else
+    {
+        if (!sampled(nodeId))
+        {
+            return;
+        }
+        SampleEntry *entry = sampleEntry(nodeId);
+        if (!entry)
+        {
+            return;
+        }
+        edge_relaxations = &entry->edge_relaxations;
+        relaxed = &entry->relaxed;
+    }
+    __atomic_fetch_add(edge_relaxations, neighborhood_size, __ATOMIC_RELAXED);
+    if (!*relaxed)
+    {
+        __atomic_store_n(relaxed, 1, __ATOMIC_RELAXED);
+    }
 }
 
 
@@ -49,27 +255,145 @@ void SSSPMetrics::reset_round(unsigned long long sourceNode)
 
 void SSSPMetrics::reset_round()
 {
-    auto lck = std::unique_lock<std::mutex>(_access_guard);
-    _insertions_by_id.clear();
-    _insertions_by_id.push_back({});
-    _insertions_per_node.clear();
-    _edge_relaxations_per_node.clear();
+    clearCounters();
+    for (auto &count : _step_count)
+    {
+        count.value = 0;
+    }
+    _insertions_per_step.clear();
+    _phase_counters.clear();
+    nextStamp();
     _currentStep = 0;
 }
 
 void SSSPMetrics::dump(unsigned long long sourceNode)
 {
-    _backend->dump(this,sourceNode);
+    if (!_backend)
+    {
+        return;
+    }
+    MetricsSnapshot snapshot;
+    snapshot.sourceNode = sourceNode;
+    snapshot.processors = __cilkrts_get_nworkers();
+    snapshot.sampleRate = _rate;
+    snapshot.insertionsPerStep = getInsertionsPerStep();
+    snapshot.phaseCounters = _phase_counters;
+    if (_backend->perNode())
+    {
+        snapshot.insertions = snapshot.edgeRelaxations = CounterStats{};
+        snapshot.nodes = getNodeCounters();
+    }
+    else
+    {
+        snapshot.insertions = counterStats(getInsertionsPerNode(), _rate);
+        snapshot.edgeRelaxations = counterStats(getEdgeRelaxationsPerNode(), _rate);
+    }
+    size_t bytes = snapshotBytes(snapshot);
+    auto lck = std::unique_lock<std::mutex>(_pending_guard);
+    _pending_changed.wait(lck, [&] { return _pending.empty() || _pending_bytes + bytes <= METRICS_QUEUE_BYTES; });
+    _pending_bytes += bytes;
+    _pending.push_back(std::move(snapshot));
+    _pending_changed.notify_all();
 }
 
-std::vector<std::set<unsigned long long>> &SSSPMetrics::getRoundMetrics() {
-    return _insertions_by_id;
+size_t SSSPMetrics::snapshotBytes(const MetricsSnapshot &snapshot)
+{
+    return sizeof(snapshot) + snapshot.insertionsPerStep.capacity() * sizeof(unsigned long) +
+           snapshot.phaseCounters.capacity() * sizeof(PhaseCounters) + snapshot.nodes.capacity() * sizeof(NodeCounters);
 }
 
-std::map<unsigned long long, unsigned long> &SSSPMetrics::getInsertionsPerNode() {
-    return _insertions_per_node;
+void SSSPMetrics::setPhaseCounters(const std::vector<PhaseCounters> &counters) {
+    _phase_counters = counters;
 }
 
-std::map<unsigned long long, unsigned long> &SSSPMetrics::getEdgeRelaxationsPerNode() {
-    return _edge_relaxations_per_node;
+const std::vector<PhaseCounters> &SSSPMetrics::getPhaseCounters() {
+    return _phase_counters;
+}
+
+std::vector<unsigned long> SSSPMetrics::getInsertionsPerStep() {
+    std::vector<unsigned long> steps = _insertions_per_step;
+    steps.push_back(currentStepCount());
+    return steps;
+}
+
+std::vector<unsigned long> SSSPMetrics::getInsertionsPerNode() {
+    std::vector<unsigned long> values;
+    if (_rate == 1)
+    {
+        for (unsigned long long i = 0; i < _n; i++)
+        {
+            if (_insertions_per_node[i])
+            {
+                values.push_back(_insertions_per_node[i]);
+            }
+        }
+        return values;
+    }
+    std::vector<std::pair<unsigned long long, unsigned long>> entries;
+    for (auto &entry : _samples)
+    {
+        if (entry.nodeId != EMPTY_SLOT && entry.insertions)
+        {
+            entries.push_back({entry.nodeId, entry.insertions});
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+    for (auto &entry : entries)
+    {
+        values.push_back(entry.second);
+    }
+    return values;
+}
+
+std::vector<unsigned long> SSSPMetrics::getEdgeRelaxationsPerNode() {
+    std::vector<unsigned long> values;
+    if (_rate == 1)
+    {
+        for (unsigned long long i = 0; i < _n; i++)
+        {
+            if (_relaxed[i])
+            {
+                values.push_back(_edge_relaxations_per_node[i]);
+            }
+        }
+        return values;
+    }
+    std::vector<std::pair<unsigned long long, unsigned long>> entries;
+    for (auto &entry : _samples)
+    {
+        if (entry.nodeId != EMPTY_SLOT && entry.relaxed)
+        {
+            entries.push_back({entry.nodeId, entry.edge_relaxations});
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+    for (auto &entry : entries)
+    {
+        values.push_back(entry.second);
+    }
+    return values;
+}
+
+std::vector<NodeCounters> SSSPMetrics::getNodeCounters() {
+    std::vector<NodeCounters> nodes;
+    if (_rate == 1)
+    {
+        for (unsigned long long i = 0; i < _n; i++)
+        {
+            if (_insertions_per_node[i] || _relaxed[i])
+            {
+                nodes.push_back({i, _insertions_per_node[i], _relaxed[i] != 0, _edge_relaxations_per_node[i]});
+            }
+        }
+        return nodes;
+    }
+    for (auto &entry : _samples)
+    {
+        if (entry.nodeId != EMPTY_SLOT && (entry.insertions || entry.relaxed))
+        {
+            nodes.push_back({entry.nodeId, entry.insertions, entry.relaxed != 0, entry.edge_relaxations});
+        }
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const NodeCounters &a, const NodeCounters &b) { return a.nodeId < b.nodeId; });
+    return nodes;
 }
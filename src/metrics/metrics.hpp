@@ -1,38 +1,133 @@
 #ifndef __METRICS_HPP__
 #define __METRICS_HPP__
 
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <mutex>
-#include <set>
+#include <string>
+#include <thread>
 #include <vector>
-#include <map>
 
 class BackendInterface;
 
+constexpr int NUM_PERF_EVENTS = 4;
+// Column names of the hardware counters, in the order of PhaseCounters::events
+constexpr const char *PERF_EVENT_NAMES[NUM_PERF_EVENTS] = {"instructions", "cycles", "cache_misses", "dtlb_load_misses"};
+
+// Time and hardware counters of one phase of a round, summed over all workers. -1 marks events the machine does not provide
+struct PhaseCounters {
+    std::string phase;
+    double seconds;
+    long long events[NUM_PERF_EVENTS];
+};
+
+// Counters of one node that was inserted or relaxed in a round
+struct NodeCounters {
+    unsigned long long nodeId;
+    uint32_t insertions;
+    bool relaxed;
+    uint64_t edgeRelaxations;
+};
+
+// Statistics of a per-node counter over the nodes that have it, see VectorStats. total is scaled up by the sample rate,
+// count is the number of sampled nodes
+struct CounterStats {
+    unsigned long count;
+    unsigned long total;
+    double mean;
+    unsigned long median;
+    unsigned long firstQuartile;
+    unsigned long thirdQuartile;
+};
+
+// Everything a backend stores about one round, copied out of SSSPMetrics so that it can be written while the next round runs
+struct MetricsSnapshot {
+    unsigned long long sourceNode;
+    int processors;
+    unsigned long sampleRate;
+    // Left zero for backends that store every node
+    CounterStats insertions;
+    CounterStats edgeRelaxations;
+    std::vector<unsigned long> insertionsPerStep;
+    std::vector<PhaseCounters> phaseCounters;
+    // Only filled for backends that store every node, see BackendInterface::perNode
+    std::vector<NodeCounters> nodes;
+};
+
+// Rounds written in one backend transaction at most
+constexpr size_t METRICS_BATCH = 64;
+// Bytes of queued rounds before reset_round blocks, a single larger round is still queued
+constexpr size_t METRICS_QUEUE_BYTES = 64 << 20;
+
 /*
-This class logs advanced metrics from the execution of the SSSP algorithm. Since it is written to be correct but not fast, it will slow down
-the execution speed of the programm considerably
+This class logs advanced metrics from the execution of the SSSP algorithm. All counters live in dense per-vertex arrays that are
+updated with relaxed atomics, the distinct insertions of a step are counted by the worker that first stamps a vertex with the step,
+so logging takes no locks and allocates nothing while the algorithm runs. Finished rounds are handed to a writer thread that
+stores them in batches, so the backend never blocks the benchmark loop unless it falls METRICS_QUEUE_BYTES behind. A round is
+reduced to the aggregates the backend stores before it is queued.
+With a sample rate R > 1 only the nodes whose hash is divisible by R are tracked, in an open addressing table of about 2n/R entries
+instead of the per-node arrays, and the per-step counts are scaled up by R
 */
 class SSSPMetrics {
     private:
-        // long long to enable graphs with more than 2^32-1 nodes
-        // Use vector to record multiple rounds at once
-        std::vector<std::set<unsigned long long>> _insertions_by_id;
-        std::map<unsigned long long, unsigned long> _insertions_per_node;
-        std::map<unsigned long long, unsigned long> _edge_relaxations_per_node;
-        
-        // Protect functions which mutate the state from race conditions
-        std::mutex _access_guard;
+        // Keep the per-worker counters on separate cache lines
+        struct alignas(64) WorkerCount {
+            unsigned long value;
+        };
+        static constexpr unsigned long long EMPTY_SLOT = ~0ULL;
+        struct SampleEntry {
+            unsigned long long nodeId;
+            uint32_t insertions;
+            uint32_t step_stamp;
+            uint64_t edge_relaxations;
+            uint8_t relaxed;
+        };
+
+        unsigned long long _n;
+        unsigned long _rate;
+        // Tracked nodes when sampling, the capacity is a power of two
+        std::vector<SampleEntry> _samples;
+        // Sampled nodes that found no free slot
+        unsigned long _dropped;
+        // Insertions and relaxed edges of every node in the current round
+        std::vector<uint32_t> _insertions_per_node;
+        std::vector<uint64_t> _edge_relaxations_per_node;
+        // Set once a node was relaxed, even over an empty neighborhood
+        std::vector<uint8_t> _relaxed;
+        // Last step in which a node was inserted, steps are numbered globally so the stamps never need to be cleared
+        std::vector<uint32_t> _step_stamp;
+        uint32_t _stamp;
+        // Distinct insertions of the current step per worker
+        std::vector<WorkerCount> _step_count;
+        // Distinct insertions of the finished steps of the round
+        std::vector<unsigned long> _insertions_per_step;
+        std::vector<PhaseCounters> _phase_counters;
 
         // The current step in the algorithm
         int _currentStep;
 
         BackendInterface *_backend;
+        std::deque<MetricsSnapshot> _pending;
+        size_t _pending_bytes;
+        std::mutex _pending_guard;
+        std::condition_variable _pending_changed;
+        bool _closing;
+        std::thread _writer;
 
-        // Log the data for every distinct round
+        // Queue the data of every distinct round for the writer
         void dump(unsigned long long sourceNode);
+        void writeLoop();
+        static size_t snapshotBytes(const MetricsSnapshot &snapshot);
+        unsigned long currentStepCount();
+        void nextStamp();
+        bool sampled(unsigned long long nodeId) const;
+        // Slot of a sampled node, claims a free one on first use, nullptr if the table is full
+        SampleEntry *sampleEntry(unsigned long long nodeId);
+        void clearCounters();
     
     public:
-        SSSPMetrics(BackendInterface *interface);
+        SSSPMetrics(BackendInterface *interface, unsigned long long n, unsigned long rate = 1);
         void log_node_add(unsigned long long nodeId);
         void log_node_relax(unsigned long long nodeId, unsigned long neighborhood_size);
 
@@ -40,17 +135,27 @@ class SSSPMetrics {
         void reset_round(unsigned long long sourceNode);
         void reset_round();
 
-        // Increase the current algorithm step
+        // Increase the current algorithm step, must not run concurrently with logging
         void incAlgorithmStep();
 
         int getCurrentTotalCount();
+        // 1 if every node is tracked, otherwise the per-node vectors hold about one of every rate nodes
+        unsigned long getSampleRate() const;
 
-        // Use RAII
+        // Use RAII, waits until every queued round is stored
         ~SSSPMetrics();
 
-        std::vector<std::set<unsigned long long>> &getRoundMetrics();
-        std::map<unsigned long long, unsigned long> &getInsertionsPerNode();
-        std::map<unsigned long long, unsigned long> &getEdgeRelaxationsPerNode();
+        // Hardware counters of the round, dumped with the other metrics
+        void setPhaseCounters(const std::vector<PhaseCounters> &counters);
+        const std::vector<PhaseCounters> &getPhaseCounters();
+
+        // Distinct inserted nodes of every step, including the current one, estimated from the sample
+        std::vector<unsigned long> getInsertionsPerStep();
+        // Values of the nodes that were inserted / relaxed at least once, in order of node id
+        std::vector<unsigned long> getInsertionsPerNode();
+        std::vector<unsigned long> getEdgeRelaxationsPerNode();
+        // Every node that was inserted or relaxed, in order of node id
+        std::vector<NodeCounters> getNodeCounters();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -14,7 +14,9 @@ template<typename T>class VectorStats {
         T _first_quartile;
         T _third_quartile;
     public:
-        VectorStats(std::vector<T> *vec, T def_value) {
+        // vec may be a sample of every scale-th value, the sum is then scaled up while the other statistics are
+        // taken from the sample as is
+        VectorStats(std::vector<T> *vec, T def_value, T scale = 1) {
             _mean = 0.0;
             _stddev = 0.0;
             _median = def_value;
@@ -42,6 +44,7 @@ template<typename T>class VectorStats {
                 _first_quartile = (*vec)[first];
                 _third_quartile = (*vec)[third];
             }
+            _sum *= scale;
         }
 
         double mean() {
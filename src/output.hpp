@@ -0,0 +1,166 @@
+#pragma once
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "graph.hpp"
+#include "varint.hpp"
+
+constexpr uint64_t DIST_MAGIC = 0x3154534450535353ULL;   // "SSSPDST1"
+constexpr uint64_t DISTZ_MAGIC = 0x315a534450535353ULL;  // "SSSPDSZ1"
+constexpr size_t DIST_WRITE_BUFFERS = 2;
+
+// Every file starts with this header. In PREFIX.SOURCE.dist it is followed
+// by n EdgeTy distances, so the file can be mapped and indexed directly. In
+// PREFIX.SOURCE.distz unreachable vertices are left out and every reached
+// vertex is stored as varint(gap to the previous reached id) and
+// varint(distance), in increasing order of id.
+struct DistanceHeader {
+  uint64_t magic;
+  uint64_t n;
+  uint64_t source;
+  uint64_t reached;
+};
+
+// Reads either layout back, unreachable vertices get INT_MAX / 2
+inline bool load_distances(const std::string &path, uint64_t &source,
+                           std::vector<EdgeTy> &dist) {
+  ifstream ifs(path, ios::binary);
+  DistanceHeader h;
+  if (!ifs.read(reinterpret_cast<char *>(&h), sizeof(h))) {
+    return false;
+  }
+  source = h.source;
+  dist.assign(h.n, INT_MAX / 2);
+  if (h.magic == DIST_MAGIC) {
+    return bool(ifs.read(reinterpret_cast<char *>(dist.data()),
+                         h.n * sizeof(EdgeTy)));
+  } else if (h.magic != DISTZ_MAGIC) {
+    return false;
+  }
+  std::string body((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+  const unsigned char *p = (const unsigned char *)body.data();
+  const unsigned char *end = p + body.size();
+  uint64_t v = 0;
+  for (uint64_t i = 0; i < h.reached; i++) {
+    if (p >= end) {
+      return false;
+    }
+    v += get_varint(p) + (i > 0);
+    if (v >= h.n) {
+      return false;
+    }
+    dist[v] = get_varint(p);
+  }
+  return true;
+}
+
+// Writes distance arrays from a background thread. write() copies the array
+// into one of DIST_WRITE_BUFFERS buffers and returns, so the file I/O and
+// compression overlap the next query; it only blocks when every buffer is
+// still queued.
+class DistanceWriter {
+ private:
+  std::string prefix;
+  bool compressed;
+  std::vector<std::vector<EdgeTy>> buffers;
+  std::vector<size_t> idle;
+  std::deque<pair<size_t, uint64_t>> pending;  // buffer, source
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool done;
+  std::thread worker;
+
+  void save(const std::vector<EdgeTy> &dist, uint64_t source) {
+    std::string path = prefix + "." + std::to_string(source) +
+                       (compressed ? ".distz" : ".dist");
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+      fprintf(stderr, "Warning: Cannot write distances to %s\n", path.c_str());
+      return;
+    }
+    DistanceHeader h{compressed ? DISTZ_MAGIC : DIST_MAGIC, dist.size(),
+                     source, 0};
+    std::string body;
+    uint64_t prev = 0;
+    for (size_t v = 0; v < dist.size(); v++) {
+      if (dist[v] >= INT_MAX / 2) {
+        continue;
+      }
+      if (compressed) {
+        put_varint(body, v - prev - (h.reached > 0));
+        put_varint(body, dist[v]);
+        prev = v;
+      }
+      h.reached++;
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    if (compressed) {
+      ok = ok && fwrite(body.data(), 1, body.size(), f) == body.size();
+    } else {
+      ok = ok && fwrite(dist.data(), sizeof(EdgeTy), dist.size(), f) ==
+                     dist.size();
+    }
+    if (fclose(f) != 0 || !ok) {
+      fprintf(stderr, "Warning: Incomplete distance file %s\n", path.c_str());
+    }
+  }
+
+  void loop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+      cv.wait(lock, [&] { return done || !pending.empty(); });
+      if (pending.empty()) {
+        return;
+      }
+      auto [b, source] = pending.front();
+      pending.pop_front();
+      lock.unlock();
+      save(buffers[b], source);
+      lock.lock();
+      idle.push_back(b);
+      cv.notify_all();
+    }
+  }
+
+ public:
+  DistanceWriter() = delete;
+  DistanceWriter(const std::string &_prefix, size_t n, bool _compressed)
+      : prefix(_prefix), compressed(_compressed), done(false) {
+    for (size_t i = 0; i < DIST_WRITE_BUFFERS; i++) {
+      buffers.emplace_back(n);
+      idle.push_back(i);
+    }
+    worker = std::thread([this] { loop(); });
+  }
+  // Flushes every queued array
+  ~DistanceWriter() {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      done = true;
+    }
+    cv.notify_all();
+    worker.join();
+  }
+
+  void write(uint64_t source, const EdgeTy *dist) {
+    size_t b;
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      cv.wait(lock, [&] { return !idle.empty(); });
+      b = idle.back();
+      idle.pop_back();
+    }
+    EdgeTy *buf = buffers[b].data();
+    parallel_for(0, buffers[b].size(), [&](size_t i) { buf[i] = dist[i]; });
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      pending.push_back(make_pair(b, source));
+    }
+    cv.notify_all();
+  }
+};
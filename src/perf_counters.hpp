@@ -0,0 +1,201 @@
+#pragma once
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "metrics/metrics.hpp"
+
+enum PerfPhase { perf_query = 0, perf_relax, perf_pack, NUM_PERF_PHASES };
+
+// Counts PERF_EVENT_NAMES with perf_event_open on every thread the process
+// has when it is created, so it has to be created after the scheduler
+// started its workers. The events of a thread form one group that is read
+// with a single syscall. Phases may nest, each one accumulates the counts of
+// all threads between its start and stop, scaled for multiplexing. Events
+// that cannot be opened (no PMU, perf_event_paranoid, containers) are
+// reported as -1 and the phase times are still taken.
+class PerfCounters {
+ private:
+  using Clock = std::chrono::steady_clock;
+  // Event group of one thread, slot[e] is the position of event e in a read
+  // of the leader, -1 if it could not be opened
+  struct ThreadGroup {
+    int leader;
+    std::array<int, NUM_PERF_EVENTS> fd;
+    std::array<int, NUM_PERF_EVENTS> slot;
+  };
+  std::vector<ThreadGroup> groups;
+  bool event_ok[NUM_PERF_EVENTS];
+  long long begin[NUM_PERF_PHASES][NUM_PERF_EVENTS];
+  long long total[NUM_PERF_PHASES][NUM_PERF_EVENTS];
+  Clock::time_point begin_time[NUM_PERF_PHASES];
+  double seconds[NUM_PERF_PHASES];
+  bool used[NUM_PERF_PHASES];
+
+  static perf_event_attr event_attr(int e) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    if (e == 0) {
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    } else if (e == 1) {
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    } else if (e == 2) {
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    } else {
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                    (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return attr;
+  }
+
+  static std::vector<pid_t> threads() {
+    std::vector<pid_t> tids;
+    DIR *dir = opendir("/proc/self/task");
+    if (!dir) {
+      tids.push_back(syscall(SYS_gettid));
+      return tids;
+    }
+    while (dirent *d = readdir(dir)) {
+      if (d->d_name[0] != '.') {
+        tids.push_back(atoi(d->d_name));
+      }
+    }
+    closedir(dir);
+    return tids;
+  }
+
+  // Counts of all threads, extrapolated if a group was multiplexed
+  void sample(long long *out) {
+    for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+      out[e] = 0;
+    }
+    // nr, time enabled, time running and one value per event
+    uint64_t buf[3 + NUM_PERF_EVENTS];
+    for (auto &g : groups) {
+      ssize_t k = g.leader >= 0 ? read(g.leader, buf, sizeof(buf)) : 0;
+      if (k < (ssize_t)(3 * sizeof(uint64_t)) || buf[2] == 0) {
+        continue;
+      }
+      double scale = (double)buf[1] / buf[2];
+      for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+        if (g.slot[e] >= 0 && (uint64_t)g.slot[e] < buf[0]) {
+          out[e] += (long long)(buf[3 + g.slot[e]] * scale);
+        }
+      }
+    }
+  }
+
+  void open_phase(PerfPhase p, const long long *now, Clock::time_point t) {
+    for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+      begin[p][e] = now[e];
+    }
+    begin_time[p] = t;
+  }
+  void close_phase(PerfPhase p, const long long *now, Clock::time_point t) {
+    for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+      total[p][e] += now[e] - begin[p][e];
+    }
+    seconds[p] += std::chrono::duration<double>(t - begin_time[p]).count();
+    used[p] = true;
+  }
+
+ public:
+  PerfCounters() {
+    for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+      event_ok[e] = false;
+    }
+    for (int p = 0; p < NUM_PERF_PHASES; p++) {
+      used[p] = false;
+    }
+    for (pid_t tid : threads()) {
+      ThreadGroup g;
+      g.leader = -1;
+      int slots = 0;
+      for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+        perf_event_attr attr = event_attr(e);
+        g.fd[e] = syscall(SYS_perf_event_open, &attr, tid, -1, g.leader, 0);
+        g.slot[e] = g.fd[e] >= 0 ? slots++ : -1;
+        if (g.leader < 0) {
+          g.leader = g.fd[e];
+        }
+        event_ok[e] |= g.fd[e] >= 0;
+      }
+      groups.push_back(g);
+    }
+    for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+      if (!event_ok[e]) {
+        fprintf(stderr, "Warning: Hardware counter %s is not available\n",
+                PERF_EVENT_NAMES[e]);
+      }
+    }
+    take();
+  }
+  ~PerfCounters() {
+    for (auto &g : groups) {
+      for (int fd : g.fd) {
+        if (fd >= 0) {
+          close(fd);
+        }
+      }
+    }
+  }
+
+  size_t num_threads() const { return groups.size(); }
+
+  void start(PerfPhase p) {
+    long long now[NUM_PERF_EVENTS];
+    sample(now);
+    open_phase(p, now, Clock::now());
+  }
+  void stop(PerfPhase p) {
+    long long now[NUM_PERF_EVENTS];
+    sample(now);
+    close_phase(p, now, Clock::now());
+  }
+  // stop(from) and start(to) on a single reading
+  void next(PerfPhase from, PerfPhase to) {
+    long long now[NUM_PERF_EVENTS];
+    sample(now);
+    Clock::time_point t = Clock::now();
+    close_phase(from, now, t);
+    open_phase(to, now, t);
+  }
+
+  // Returns the phases measured since the last call and starts over
+  std::vector<PhaseCounters> take() {
+    static const char *names[] = {"sssp", "relax", "pack"};
+    std::vector<PhaseCounters> res;
+    for (int p = 0; p < NUM_PERF_PHASES; p++) {
+      if (used[p]) {
+        PhaseCounters c;
+        c.phase = names[p];
+        c.seconds = seconds[p];
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+          c.events[e] = event_ok[e] ? total[p][e] : -1;
+        }
+        res.push_back(c);
+      }
+      used[p] = false;
+      seconds[p] = 0;
+      for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+        total[p][e] = 0;
+      }
+    }
+    return res;
+  }
+};
@@ -0,0 +1,289 @@
+#pragma once
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "graph_digest.hpp"
+#include "sssp.h"
+
+constexpr size_t RADIUS_BALL = 32;
+constexpr uint64_t RADIUS_MAGIC = 0x3230505453444152ULL;  // "RADSTP02"
+
+// Radius-stepping (Blelloch, Gu, Sun, Tangwongsan, SPAA 2016). Every vertex
+// v gets a radius r(v), the distance to its rho-th nearest vertex, and a
+// shortcut to every vertex of that ball. Each step settles all vertices
+// within min(dist(v) + r(v)) over the unsettled vertices, which with the
+// shortcuts takes a constant number of Bellman-Ford substeps. The
+// preprocessing is cached on disk next to the input graph.
+class RadiusStepping : public SSSPSolver {
+ private:
+  // G plus the shortcut edges, and the radius of every vertex
+  struct Shortcuts {
+    sequence<EdgeId> offset;
+    sequence<Edge> edge;
+    sequence<EdgeTy> radius;
+  };
+
+  const Graph &G;
+  size_t rho;
+  // built once and shared with the clones
+  std::shared_ptr<const Shortcuts> sc;
+  sequence<EdgeTy> dist;
+  sequence<uint32_t> settled;
+  sequence<uint32_t> in_active;
+  sequence<uint32_t> stamp;
+  uint32_t substep;
+  SSSPMetrics *metrics;
+
+  // Truncated Dijkstra from every vertex until rho vertices are settled
+  static void preprocess(const Graph &G, size_t rho, Shortcuts &out) {
+    std::vector<std::vector<Edge>> shortcut(G.n);
+    out.radius = sequence<EdgeTy>(G.n);
+    parallel_for(0, G.n, [&](size_t u) {
+      std::unordered_map<NodeId, EdgeTy> d;
+      priority_queue<pair<EdgeTy, NodeId>, vector<pair<EdgeTy, NodeId>>,
+                     greater<pair<EdgeTy, NodeId>>>
+          pq;
+      d[u] = 0;
+      pq.push(make_pair(0, u));
+      size_t ball = 0;
+      EdgeTy r = 0;
+      while (!pq.empty() && ball < rho) {
+        auto [dv, v] = pq.top();
+        pq.pop();
+        if (d[v] < dv) continue;
+        ball++;
+        r = dv;
+        if (v != u) {
+          shortcut[u].push_back(Edge(v, dv));
+        }
+        for (size_t j = G.offset[v]; j < G.offset[v + 1]; j++) {
+          NodeId x = G.edge[j].v;
+          EdgeTy nd = dv + G.edge[j].w;
+          auto it = d.find(x);
+          if (it == d.end() || nd < it->second) {
+            d[x] = nd;
+            pq.push(make_pair(nd, x));
+          }
+        }
+      }
+      out.radius[u] = r;
+    }, 1);
+    out.offset = sequence<EdgeId>(G.n + 1);
+    parallel_for(0, G.n, [&](size_t u) {
+      out.offset[u] = G.offset[u + 1] - G.offset[u] + shortcut[u].size();
+    });
+    out.offset[G.n] = 0;
+    size_t m = scan_inplace(out.offset.slice(),
+                            monoid([](EdgeId a, EdgeId b) { return a + b; }, 0));
+    out.edge = sequence<Edge>(m);
+    parallel_for(0, G.n, [&](size_t u) {
+      EdgeId pos = out.offset[u];
+      for (size_t j = G.offset[u]; j < G.offset[u + 1]; j++) {
+        out.edge[pos++] = G.edge[j];
+      }
+      for (auto &e : shortcut[u]) {
+        out.edge[pos++] = e;
+      }
+    });
+  }
+
+  // The cache is keyed by the digest of G with the weights it is solved
+  // with, so generated weights or another graph under the same name are
+  // never mistaken for the cached one
+  static bool load(const Graph &G, size_t rho, const std::string &path,
+                   const std::string &digest, Shortcuts &out) {
+    ifstream ifs(path, ios::binary);
+    if (!ifs.is_open()) {
+      return false;
+    }
+    uint64_t header[5];
+    char key[2 * SHA_DIGEST_LENGTH];
+    ifs.read(reinterpret_cast<char *>(header), sizeof(header));
+    ifs.read(key, sizeof(key));
+    if (!ifs || header[0] != RADIUS_MAGIC || header[1] != G.n ||
+        header[2] != G.m || header[3] != rho ||
+        digest.compare(0, digest.size(), key, sizeof(key))) {
+      return false;
+    }
+    size_t m = header[4];
+    out.offset = sequence<EdgeId>(G.n + 1);
+    out.edge = sequence<Edge>(m);
+    out.radius = sequence<EdgeTy>(G.n);
+    ifs.read(reinterpret_cast<char *>(out.offset.begin()),
+             (G.n + 1) * sizeof(EdgeId));
+    ifs.read(reinterpret_cast<char *>(out.edge.begin()), m * sizeof(Edge));
+    ifs.read(reinterpret_cast<char *>(out.radius.begin()),
+             G.n * sizeof(EdgeTy));
+    return ifs.good();
+  }
+
+  static void save(const Graph &G, size_t rho, const std::string &path,
+                   const std::string &digest, const Shortcuts &sc) {
+    ofstream ofs(path, ios::binary);
+    if (!ofs.is_open()) {
+      fprintf(stderr, "Warning: Cannot write radius-stepping cache %s\n",
+              path.c_str());
+      return;
+    }
+    uint64_t header[5] = {RADIUS_MAGIC, G.n, G.m, rho, sc.edge.size()};
+    ofs.write(reinterpret_cast<char *>(header), sizeof(header));
+    ofs.write(digest.data(), digest.size());
+    ofs.write(reinterpret_cast<const char *>(sc.offset.begin()),
+              (G.n + 1) * sizeof(EdgeId));
+    ofs.write(reinterpret_cast<const char *>(sc.edge.begin()),
+              sc.edge.size() * sizeof(Edge));
+    ofs.write(reinterpret_cast<const char *>(sc.radius.begin()),
+              G.n * sizeof(EdgeTy));
+    ofs.close();
+    if (!ofs) {
+      // a truncated cache would only be rejected on every later load
+      fprintf(stderr, "Warning: Cannot write radius-stepping cache %s\n",
+              path.c_str());
+      remove(path.c_str());
+    }
+  }
+
+  static std::shared_ptr<const Shortcuts> build(const Graph &G, size_t rho,
+                                                const std::string &cache) {
+    auto out = std::make_shared<Shortcuts>();
+    std::string digest = cache.empty() ? "" : graph_digest(G);
+    if (!cache.empty() && load(G, rho, cache, digest, *out)) {
+      fprintf(stderr, "Info: Loaded radius-stepping shortcuts from %s\n",
+              cache.c_str());
+      return out;
+    }
+    fprintf(stderr, "Info: Computing radius-stepping shortcuts (rho=%zu)\n",
+            rho);
+    timer tm;
+    preprocess(G, rho, *out);
+    tm.stop();
+    fprintf(stderr, "Info: Added %zu shortcuts in %f\n",
+            out->edge.size() - G.m, tm.get_total());
+    if (!cache.empty()) {
+      save(G, rho, cache, digest, *out);
+    }
+    return out;
+  }
+
+  // Relaxes the out-edges of F, returns every vertex whose distance dropped
+  sequence<NodeId> relax(const sequence<NodeId> &F) {
+    substep++;
+    sequence<EdgeId> pos(F.size() + 1);
+    parallel_for(0, F.size(), [&](size_t i) {
+      pos[i] = sc->offset[F[i] + 1] - sc->offset[F[i]];
+    });
+    pos[F.size()] = 0;
+    size_t total = scan_inplace(
+        pos.slice(), monoid([](EdgeId a, EdgeId b) { return a + b; }, 0));
+    sequence<NodeId> out(total);
+    parallel_for(0, F.size(), [&](size_t i) {
+      NodeId u = F[i];
+      if (metrics) {
+        metrics->log_node_relax(u, sc->offset[u + 1] - sc->offset[u]);
+      }
+      parallel_for(sc->offset[u], sc->offset[u + 1], [&](size_t es) {
+        NodeId v = sc->edge[es].v;
+        NodeId res = UINT_MAX;
+        if (write_min(&dist[v], dist[u] + sc->edge[es].w,
+                      [](EdgeTy w1, EdgeTy w2) { return w1 < w2; })) {
+          uint32_t old = stamp[v];
+          if (old != substep &&
+              atomic_compare_and_swap(&stamp[v], old, substep)) {
+            res = v;
+          }
+        }
+        out[pos[i] + es - sc->offset[u]] = res;
+      });
+    });
+    return filter(out, [](NodeId v) { return v != UINT_MAX; });
+  }
+
+  RadiusStepping(const Graph &_G, size_t _rho,
+                 std::shared_ptr<const Shortcuts> _sc, SSSPMetrics *_mets)
+      : G(_G), rho(_rho), sc(std::move(_sc)), metrics(_mets) {
+    dist = sequence<EdgeTy>(G.n);
+    settled = sequence<uint32_t>(G.n);
+    in_active = sequence<uint32_t>(G.n);
+    stamp = sequence<uint32_t>(G.n);
+    substep = 0;
+  }
+
+ public:
+  RadiusStepping() = delete;
+  RadiusStepping(const Graph &_G, size_t _rho, const std::string &cache,
+                 SSSPMetrics *_mets)
+      : RadiusStepping(_G, max<size_t>(_rho, 1),
+                       build(_G, max<size_t>(_rho, 1), cache), _mets) {}
+
+  SSSPSolver *clone() const override {
+    return new RadiusStepping(G, rho, sc, nullptr);
+  }
+
+  size_t memory_bytes() const override {
+    return sc->offset.size() * sizeof(EdgeId) + sc->edge.size() * sizeof(Edge) +
+           (sc->radius.size() + dist.size()) * sizeof(EdgeTy) +
+           (settled.size() + in_active.size() + stamp.size()) *
+               sizeof(uint32_t);
+  }
+
+  void sssp(int s, EdgeTy *_dist) override {
+    if (!G.weighted) {
+      fprintf(stderr, "Error: Input graph is unweighted\n");
+      exit(EXIT_FAILURE);
+    }
+    t_all.start();
+    parallel_for(0, G.n, [&](size_t i) {
+      dist[i] = INT_MAX / 2;
+      settled[i] = in_active[i] = stamp[i] = 0;
+    });
+    substep = 0;
+    dist[s] = 0;
+    in_active[s] = 1;
+    if (metrics) {
+      metrics->log_node_add(s);
+    }
+    sequence<NodeId> active(1, (NodeId)s);
+    while (active.size()) {
+      EdgeTy d = reduce(
+          dseq(active.size(),
+               [&](size_t i) { return dist[active[i]] + sc->radius[active[i]]; }),
+          monoid([](EdgeTy a, EdgeTy b) { return min(a, b); },
+                 (EdgeTy)UINT_MAX));
+      auto F = filter(active, [&](NodeId u) { return dist[u] <= d; });
+      while (F.size()) {
+        auto improved = relax(F);
+        auto fresh = filter(improved, [&](NodeId v) {
+          return !in_active[v] &&
+                 atomic_compare_and_swap(&in_active[v], 0u, 1u);
+        });
+        if (metrics) {
+          parallel_for(0, improved.size(),
+                       [&](size_t i) { metrics->log_node_add(improved[i]); });
+        }
+        if (fresh.size()) {
+          sequence<NodeId> merged(active.size() + fresh.size());
+          parallel_for(0, active.size(), [&](size_t i) { merged[i] = active[i]; });
+          parallel_for(0, fresh.size(), [&](size_t i) {
+            merged[active.size() + i] = fresh[i];
+          });
+          active = std::move(merged);
+        }
+        F = filter(improved, [&](NodeId v) { return dist[v] <= d; });
+      }
+      parallel_for(0, active.size(), [&](size_t i) {
+        if (dist[active[i]] <= d) {
+          settled[active[i]] = 1;
+        }
+      });
+      active = filter(active, [&](NodeId u) { return !settled[u]; });
+      if (metrics) {
+        metrics->incAlgorithmStep();
+      }
+    }
+    t_all.stop();
+    parallel_for(0, G.n, [&](size_t i) { _dist[i] = dist[i]; });
+  }
+};
@@ -0,0 +1,204 @@
+#pragma once
+#include <cstdio>
+#include <vector>
+
+#include "dijkstra.hpp"
+#include "sssp.h"
+
+enum Baseline { binary_heap = 0, radix_heap, dial, dary_heap };
+
+// Single-core reference engines for integer weights, used for verification
+// and for the speedups reported by the driver. All of them run Dijkstra's
+// algorithm, they only differ in the priority queue.
+class SequentialSSSP : public SSSPSolver {
+ private:
+  static constexpr int HEAP_D = 4;
+  static constexpr int RADIX_BUCKETS = 33;
+  // Dial's algorithm keeps max_weight + 1 buckets, it is only used while
+  // that is at most max(n, DIAL_MIN_BUCKETS)
+  static constexpr size_t DIAL_MIN_BUCKETS = 1 << 16;
+
+  const Graph &G;
+  Baseline kind;
+  EdgeTy max_weight;
+  // d-ary heap with decrease-key, pos[v] is the slot of v or UINT_MAX
+  std::vector<NodeId> heap;
+  std::vector<uint32_t> pos;
+  std::vector<EdgeTy> key;
+
+  // Radix heap (Ahuja et al.), keys are monotone so every key lives in the
+  // bucket of the highest bit in which it differs from the last minimum
+  void radix_heap_sssp(size_t s, EdgeTy *dist) {
+    std::vector<pair<EdgeTy, NodeId>> bucket[RADIX_BUCKETS];
+    EdgeTy last = 0;
+    size_t size = 0;
+    auto index = [&](EdgeTy k) {
+      return k == last ? 0 : 32 - __builtin_clz(k ^ last);
+    };
+    bucket[0].push_back(make_pair(0, s));
+    size++;
+    while (size) {
+      if (bucket[0].empty()) {
+        int i = 1;
+        while (bucket[i].empty()) i++;
+        last = UINT_MAX;
+        for (auto &e : bucket[i]) last = min(last, e.first);
+        for (auto &e : bucket[i]) bucket[index(e.first)].push_back(e);
+        bucket[i].clear();
+      }
+      NodeId u = bucket[0].back().second;
+      EdgeTy d = bucket[0].back().first;
+      bucket[0].pop_back();
+      size--;
+      if (dist[u] < d) continue;
+      for (size_t j = G.offset[u]; j < G.offset[u + 1]; j++) {
+        NodeId v = G.edge[j].v;
+        EdgeTy nd = d + G.edge[j].w;
+        if (nd < dist[v]) {
+          dist[v] = nd;
+          bucket[index(nd)].push_back(make_pair(nd, v));
+          size++;
+        }
+      }
+    }
+  }
+
+  // Dial's algorithm, a circular array of max_weight + 1 buckets holds all
+  // tentative distances in [cur, cur + max_weight]
+  void dial_sssp(size_t s, EdgeTy *dist) {
+    size_t nb = (size_t)max_weight + 1;
+    std::vector<std::vector<NodeId>> bucket(nb);
+    bucket[0].push_back(s);
+    size_t size = 1;
+    for (EdgeTy cur = 0; size; cur++) {
+      auto &b = bucket[cur % nb];
+      while (!b.empty()) {
+        NodeId u = b.back();
+        b.pop_back();
+        size--;
+        if (dist[u] != cur) continue;
+        for (size_t j = G.offset[u]; j < G.offset[u + 1]; j++) {
+          NodeId v = G.edge[j].v;
+          EdgeTy nd = cur + G.edge[j].w;
+          if (nd < dist[v]) {
+            dist[v] = nd;
+            bucket[nd % nb].push_back(v);
+            size++;
+          }
+        }
+      }
+    }
+  }
+
+  void sift_up(uint32_t i) {
+    NodeId u = heap[i];
+    while (i > 0) {
+      uint32_t p = (i - 1) / HEAP_D;
+      if (key[heap[p]] <= key[u]) break;
+      heap[i] = heap[p];
+      pos[heap[i]] = i;
+      i = p;
+    }
+    heap[i] = u;
+    pos[u] = i;
+  }
+
+  void sift_down(uint32_t i) {
+    NodeId u = heap[i];
+    size_t size = heap.size();
+    while (true) {
+      size_t c = (size_t)i * HEAP_D + 1;
+      if (c >= size) break;
+      size_t best = c;
+      for (size_t k = c + 1; k < min(c + HEAP_D, size); k++) {
+        if (key[heap[k]] < key[heap[best]]) best = k;
+      }
+      if (key[u] <= key[heap[best]]) break;
+      heap[i] = heap[best];
+      pos[heap[i]] = i;
+      i = best;
+    }
+    heap[i] = u;
+    pos[u] = i;
+  }
+
+  // d-ary heap keyed by the distance array, one entry per vertex
+  void dary_heap_sssp(size_t s, EdgeTy *dist) {
+    heap.clear();
+    key.assign(dist, dist + G.n);
+    heap.push_back(s);
+    pos[s] = 0;
+    while (!heap.empty()) {
+      NodeId u = heap[0];
+      pos[u] = UINT_MAX;
+      heap[0] = heap.back();
+      heap.pop_back();
+      if (!heap.empty()) sift_down(0);
+      for (size_t j = G.offset[u]; j < G.offset[u + 1]; j++) {
+        NodeId v = G.edge[j].v;
+        EdgeTy nd = key[u] + G.edge[j].w;
+        if (nd < key[v]) {
+          key[v] = nd;
+          if (pos[v] == UINT_MAX) {
+            heap.push_back(v);
+            pos[v] = heap.size() - 1;
+          }
+          sift_up(pos[v]);
+        }
+      }
+    }
+    copy(key.begin(), key.end(), dist);
+  }
+
+  SequentialSSSP(const Graph &_G, Baseline _kind, EdgeTy _max_weight)
+      : G(_G), kind(_kind), max_weight(_max_weight) {
+    pos.assign(G.n, UINT_MAX);
+    if (kind == dial &&
+        (size_t)max_weight >= max<size_t>(G.n, DIAL_MIN_BUCKETS)) {
+      fprintf(stderr,
+              "Warning: Dial's algorithm would need %zu buckets for the "
+              "largest weight, using the radix heap instead\n",
+              (size_t)max_weight + 1);
+      kind = radix_heap;
+    }
+  }
+
+ public:
+  SequentialSSSP() = delete;
+  SequentialSSSP(const Graph &_G, Baseline _kind)
+      : SequentialSSSP(
+            _G, _kind,
+            reduce(dseq(_G.m, [&](size_t i) { return _G.edge[i].w; }),
+                   monoid([](EdgeTy a, EdgeTy b) { return max(a, b); },
+                          (EdgeTy)0))) {}
+
+  SSSPSolver *clone() const override {
+    return new SequentialSSSP(G, kind, max_weight);
+  }
+
+  // The queue that is actually used, dial may have fallen back
+  Baseline queue_kind() const { return kind; }
+
+  size_t memory_bytes() const override {
+    return heap.capacity() * sizeof(NodeId) + pos.capacity() * sizeof(uint32_t) +
+           key.capacity() * sizeof(EdgeTy);
+  }
+
+  void sssp(int s, EdgeTy *dist) override {
+    t_all.start();
+    if (kind == binary_heap) {
+      dijkstra(s, G, dist);
+    } else {
+      fill(dist, dist + G.n, INT_MAX / 2);
+      dist[s] = 0;
+      if (kind == radix_heap) {
+        radix_heap_sssp(s, dist);
+      } else if (kind == dial) {
+        dial_sssp(s, dist);
+      } else {
+        dary_heap_sssp(s, dist);
+      }
+    }
+    t_all.stop();
+  }
+};
@@ -0,0 +1,325 @@
+#pragma once
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "throughput.hpp"
+
+constexpr size_t SERVER_READ_SIZE = 1 << 16;
+
+// Keeps stdout for the replies of "-": returns a duplicate of it and points
+// stdout at stderr, so every printf of the driver and the solvers ends up in
+// the log instead of the protocol stream. Has to run before anything is
+// printed.
+inline int reserve_stdout() {
+  fflush(stdout);
+  int fd = dup(STDOUT_FILENO);
+  if (fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+    fprintf(stderr, "Error: Cannot redirect stdout: %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  // keep the log in order with the direct writes to stderr
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  return fd;
+}
+
+// Answers queries against a resident graph over a Unix domain socket or
+// stdin/stdout. The protocol is one request per line:
+//   sssp <s>        ok <latency_us> <reached vertices> <max finite distance>
+//   dist <s> <t>    ok <latency_us> <distance or inf>
+//   radius <s> <r>  ok <latency_us> <k> <v>:<d> ... (all v with d <= r)
+//   quit            closes the connection
+//   shutdown        stops the server
+// Malformed requests are answered with "error <message>". Every request that
+// arrives while a batch is computed joins the next batch, requests of a batch
+// with the same source share one query and the distinct sources run
+// concurrently on the lanes of a ThroughputRunner. The latency covers the
+// time from reading the request to formatting its answer.
+class QueryServer {
+ private:
+  using Clock = std::chrono::steady_clock;
+  enum Kind { sssp_query, dist_query, radius_query, invalid_query };
+  struct Client {
+    int in_fd, out_fd;
+    std::string in;
+    bool closing;
+  };
+  struct Request {
+    size_t client;
+    Kind kind;
+    NodeId s;
+    uint64_t arg;
+    Clock::time_point arrival;
+    uint64_t latency_us;
+    std::string response;
+  };
+
+  const Graph &G;
+  ThroughputRunner runner;
+  int listen_fd;
+  std::string socket_path;
+  std::vector<Client> clients;
+  std::vector<Request> batch;
+  bool stopping;
+  size_t num_queries, num_batches;
+  double total_latency;
+
+  void parse(size_t c, const std::string &line) {
+    std::istringstream in(line);
+    std::string cmd, rest;
+    in >> cmd;
+    if (cmd.empty()) {
+      return;
+    }
+    if (cmd == "quit") {
+      clients[c].closing = true;
+      return;
+    }
+    if (cmd == "shutdown") {
+      clients[c].closing = true;
+      stopping = true;
+      return;
+    }
+    Request r{c, invalid_query, 0, 0, Clock::now(), 0, ""};
+    uint64_t s = 0;
+    bool ok = true;
+    if (cmd == "sssp") {
+      r.kind = sssp_query;
+      ok = bool(in >> s);
+    } else if (cmd == "dist" || cmd == "radius") {
+      r.kind = cmd == "dist" ? dist_query : radius_query;
+      ok = bool(in >> s >> r.arg);
+    } else {
+      r.response = "error unknown command " + cmd + "\n";
+    }
+    if (r.kind != invalid_query) {
+      if (!ok || (in >> rest)) {
+        r.kind = invalid_query;
+        r.response = "error malformed request\n";
+      } else if (s >= G.n || (r.kind == dist_query && r.arg >= G.n)) {
+        r.kind = invalid_query;
+        r.response = "error vertex out of range\n";
+      }
+    }
+    r.s = s;
+    batch.push_back(std::move(r));
+  }
+
+  void answer(Request &r, const EdgeTy *dist) {
+    std::string body;
+    if (r.kind == sssp_query) {
+      size_t reached = reduce(
+          dseq(G.n, [&](size_t i) -> size_t { return dist[i] < INT_MAX / 2; }),
+          monoid([](size_t a, size_t b) { return a + b; }, 0));
+      EdgeTy far = reduce(
+          dseq(G.n,
+               [&](size_t i) { return dist[i] < INT_MAX / 2 ? dist[i] : 0; }),
+          monoid([](EdgeTy a, EdgeTy b) { return max(a, b); }, (EdgeTy)0));
+      body = std::to_string(reached) + " " + std::to_string(far);
+    } else if (r.kind == dist_query) {
+      EdgeTy d = dist[r.arg];
+      body = d < INT_MAX / 2 ? std::to_string(d) : "inf";
+    } else {
+      auto ball = filter(dseq(G.n, [](size_t i) { return (NodeId)i; }),
+                         [&](NodeId v) { return dist[v] <= r.arg; });
+      body = std::to_string(ball.size());
+      for (size_t i = 0; i < ball.size(); i++) {
+        body += " " + std::to_string(ball[i]) + ":" +
+                std::to_string(dist[ball[i]]);
+      }
+    }
+    r.latency_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                       Clock::now() - r.arrival)
+                       .count();
+    r.response = "ok " + std::to_string(r.latency_us) + " " + body + "\n";
+  }
+
+  void run_batch() {
+    std::vector<NodeId> sources;
+    std::vector<std::vector<size_t>> groups;
+    std::unordered_map<NodeId, size_t> group_of;
+    for (size_t i = 0; i < batch.size(); i++) {
+      if (batch[i].kind == invalid_query) {
+        continue;
+      }
+      auto it = group_of.find(batch[i].s);
+      if (it == group_of.end()) {
+        it = group_of.emplace(batch[i].s, sources.size()).first;
+        sources.push_back(batch[i].s);
+        groups.emplace_back();
+      }
+      groups[it->second].push_back(i);
+    }
+    if (sources.size()) {
+      runner.run(sources, [&](size_t i, const EdgeTy *dist) {
+        for (size_t r : groups[i]) {
+          answer(batch[r], dist);
+        }
+      });
+      num_batches++;
+    }
+    for (auto &r : batch) {
+      if (r.kind != invalid_query) {
+        num_queries++;
+        total_latency += r.latency_us;
+      }
+      Client &c = clients[r.client];
+      if (c.out_fd >= 0 && !write_all(c.out_fd, r.response)) {
+        c.closing = true;
+      }
+    }
+    batch.clear();
+  }
+
+  static bool write_all(int fd, const std::string &buf) {
+    size_t done = 0;
+    while (done < buf.size()) {
+      ssize_t k = write(fd, buf.data() + done, buf.size() - done);
+      if (k <= 0) {
+        return false;
+      }
+      done += k;
+    }
+    return true;
+  }
+
+  // Reads what is available, returns false once the client hung up
+  bool receive(size_t c) {
+    char buf[SERVER_READ_SIZE];
+    ssize_t k = read(clients[c].in_fd, buf, sizeof(buf));
+    if (k <= 0) {
+      return false;
+    }
+    std::string &in = clients[c].in;
+    in.append(buf, k);
+    size_t start = 0, end;
+    while (!clients[c].closing &&
+           (end = in.find('\n', start)) != std::string::npos) {
+      parse(c, in.substr(start, end - start));
+      start = end + 1;
+    }
+    in.erase(0, start);
+    return true;
+  }
+
+  void close_client(Client &c) {
+    if (c.in_fd > STDIN_FILENO) {
+      close(c.in_fd);
+    }
+    c.in_fd = c.out_fd = -1;
+  }
+
+ public:
+  QueryServer() = delete;
+  // solver answers on the first lane and is cloned for the others
+  QueryServer(const Graph &_G, SSSPSolver *solver)
+      : G(_G),
+        runner(_G, num_workers(), solver),
+        listen_fd(-1),
+        stopping(false),
+        num_queries(0),
+        num_batches(0),
+        total_latency(0) {
+    // a client that disconnects early must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+  }
+  ~QueryServer() {
+    for (auto &c : clients) {
+      close_client(c);
+    }
+    if (listen_fd >= 0) {
+      close(listen_fd);
+      unlink(socket_path.c_str());
+    }
+  }
+
+  size_t lanes() const { return runner.lanes(); }
+
+  // "-" serves a single client on stdin and out_fd, anything else is the
+  // path of a Unix domain socket
+  void listen_on(const char *path, int out_fd = STDOUT_FILENO) {
+    if (!strcmp(path, "-")) {
+      clients.push_back(Client{STDIN_FILENO, out_fd, "", false});
+      return;
+    }
+    socket_path = path;
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+      fprintf(stderr, "Error: Socket path %s is too long\n", path);
+      exit(EXIT_FAILURE);
+    }
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 ||
+        bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, SOMAXCONN) < 0) {
+      fprintf(stderr, "Error: Cannot listen on %s: %s\n", path,
+              strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  void serve() {
+    fflush(stdout);
+    while (!stopping) {
+      std::vector<pollfd> fds;
+      std::vector<size_t> owner;
+      if (listen_fd >= 0) {
+        fds.push_back(pollfd{listen_fd, POLLIN, 0});
+        owner.push_back(SIZE_MAX);
+      }
+      for (size_t c = 0; c < clients.size(); c++) {
+        fds.push_back(pollfd{clients[c].in_fd, POLLIN, 0});
+        owner.push_back(c);
+      }
+      if (fds.empty()) {
+        break;
+      }
+      if (poll(fds.data(), fds.size(), -1) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        fprintf(stderr, "Error: poll failed: %s\n", strerror(errno));
+        break;
+      }
+      for (size_t i = 0; i < fds.size(); i++) {
+        if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+          continue;
+        }
+        if (owner[i] == SIZE_MAX) {
+          int fd = accept(listen_fd, nullptr, nullptr);
+          if (fd >= 0) {
+            clients.push_back(Client{fd, fd, "", false});
+          }
+        } else if (!receive(owner[i])) {
+          clients[owner[i]].closing = true;
+        }
+      }
+      run_batch();
+      for (auto &c : clients) {
+        if (c.closing) {
+          close_client(c);
+        }
+      }
+      clients.erase(remove_if(clients.begin(), clients.end(),
+                              [](const Client &c) { return c.in_fd < 0; }),
+                    clients.end());
+    }
+    fprintf(stderr, "Info: Answered %zu queries in %zu batches, average "
+            "latency %.0fus\n", num_queries, num_batches,
+            num_queries ? total_latency / num_queries : 0.0);
+  }
+};
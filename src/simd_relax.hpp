@@ -0,0 +1,171 @@
+#pragma once
+#include <immintrin.h>
+
+#include <algorithm>
+
+#include "graph.hpp"
+
+// Edge scans of relax_neighbors. Distances are read through a base pointer
+// with a stride of 8 bytes (the size of Information), so the vector kernels
+// gather them with 32-bit indices and are only valid for n < 2^31.
+struct RelaxKernels {
+  const char *name;
+  // min(init, dist[e.v] + e.w) over cnt edges
+  EdgeTy (*pull_min)(const Edge *e, size_t cnt, const EdgeTy *dist,
+                     EdgeTy init);
+  // Stores the indices of the edges with du + e.w < dist[e.v] to out and
+  // returns their number
+  size_t (*push_candidates)(const Edge *e, size_t cnt, const EdgeTy *dist,
+                            EdgeTy du, uint32_t *out);
+};
+
+constexpr size_t DIST_STRIDE = 2;  // in EdgeTy
+constexpr size_t RELAX_CHUNK = 64;
+
+inline EdgeTy pull_min_scalar(const Edge *e, size_t cnt, const EdgeTy *dist,
+                              EdgeTy init) {
+  for (size_t i = 0; i < cnt; i++) {
+    init = min(init, dist[(size_t)e[i].v * DIST_STRIDE] + e[i].w);
+  }
+  return init;
+}
+
+inline size_t push_candidates_scalar(const Edge *e, size_t cnt,
+                                     const EdgeTy *dist, EdgeTy du,
+                                     uint32_t *out) {
+  size_t k = 0;
+  for (size_t i = 0; i < cnt; i++) {
+    if (du + e[i].w < dist[(size_t)e[i].v * DIST_STRIDE]) {
+      out[k++] = i;
+    }
+  }
+  return k;
+}
+
+// Splits 8 interleaved edges into their targets and weights
+__attribute__((target("avx2"))) inline void load_edges_avx2(const Edge *e,
+                                                            __m256i &v,
+                                                            __m256i &w) {
+  const __m256i perm = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  __m256i a = _mm256_permutevar8x32_epi32(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(e)), perm);
+  __m256i b = _mm256_permutevar8x32_epi32(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(e + 4)), perm);
+  v = _mm256_permute2x128_si256(a, b, 0x20);
+  w = _mm256_permute2x128_si256(a, b, 0x31);
+}
+
+__attribute__((target("avx2"))) inline EdgeTy pull_min_avx2(
+    const Edge *e, size_t cnt, const EdgeTy *dist, EdgeTy init) {
+  __m256i acc = _mm256_set1_epi32(init);
+  size_t i = 0;
+  for (; i + 8 <= cnt; i += 8) {
+    __m256i v, w;
+    load_edges_avx2(e + i, v, w);
+    __m256i dv = _mm256_i32gather_epi32(reinterpret_cast<const int *>(dist), v,
+                                        sizeof(EdgeTy) * DIST_STRIDE);
+    acc = _mm256_min_epu32(acc, _mm256_add_epi32(dv, w));
+  }
+  __m128i m = _mm_min_epu32(_mm256_castsi256_si128(acc),
+                            _mm256_extracti128_si256(acc, 1));
+  m = _mm_min_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+  m = _mm_min_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+  return pull_min_scalar(e + i, cnt - i, dist, _mm_cvtsi128_si32(m));
+}
+
+__attribute__((target("avx2"))) inline size_t push_candidates_avx2(
+    const Edge *e, size_t cnt, const EdgeTy *dist, EdgeTy du, uint32_t *out) {
+  __m256i d = _mm256_set1_epi32(du);
+  size_t k = 0, i = 0;
+  for (; i + 8 <= cnt; i += 8) {
+    __m256i v, w;
+    load_edges_avx2(e + i, v, w);
+    __m256i dv = _mm256_i32gather_epi32(reinterpret_cast<const int *>(dist), v,
+                                        sizeof(EdgeTy) * DIST_STRIDE);
+    __m256i cand = _mm256_add_epi32(d, w);
+    // cand < dv as unsigned is max(cand, dv) != cand
+    __m256i ge = _mm256_cmpeq_epi32(_mm256_max_epu32(cand, dv), cand);
+    unsigned mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(ge)) & 0xff;
+    while (mask) {
+      out[k++] = i + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  for (; i < cnt; i++) {
+    if (du + e[i].w < dist[(size_t)e[i].v * DIST_STRIDE]) {
+      out[k++] = i;
+    }
+  }
+  return k;
+}
+
+__attribute__((target("avx512f"))) inline void load_edges_avx512(
+    const Edge *e, __m512i &v, __m512i &w) {
+  const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20,
+                                         22, 24, 26, 28, 30);
+  const __m512i odd = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21,
+                                        23, 25, 27, 29, 31);
+  __m512i a = _mm512_loadu_si512(e);
+  __m512i b = _mm512_loadu_si512(e + 8);
+  v = _mm512_permutex2var_epi32(a, even, b);
+  w = _mm512_permutex2var_epi32(a, odd, b);
+}
+
+__attribute__((target("avx512f"))) inline EdgeTy pull_min_avx512(
+    const Edge *e, size_t cnt, const EdgeTy *dist, EdgeTy init) {
+  __m512i acc = _mm512_set1_epi32(init);
+  size_t i = 0;
+  for (; i + 16 <= cnt; i += 16) {
+    __m512i v, w;
+    load_edges_avx512(e + i, v, w);
+    __m512i dv =
+        _mm512_i32gather_epi32(v, dist, sizeof(EdgeTy) * DIST_STRIDE);
+    acc = _mm512_min_epu32(acc, _mm512_add_epi32(dv, w));
+  }
+  return pull_min_scalar(e + i, cnt - i, dist, _mm512_reduce_min_epu32(acc));
+}
+
+__attribute__((target("avx512f"))) inline size_t push_candidates_avx512(
+    const Edge *e, size_t cnt, const EdgeTy *dist, EdgeTy du, uint32_t *out) {
+  __m512i d = _mm512_set1_epi32(du);
+  size_t k = 0, i = 0;
+  for (; i + 16 <= cnt; i += 16) {
+    __m512i v, w;
+    load_edges_avx512(e + i, v, w);
+    __m512i dv =
+        _mm512_i32gather_epi32(v, dist, sizeof(EdgeTy) * DIST_STRIDE);
+    unsigned mask = _mm512_cmplt_epu32_mask(_mm512_add_epi32(d, w), dv);
+    while (mask) {
+      out[k++] = i + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  for (; i < cnt; i++) {
+    if (du + e[i].w < dist[(size_t)e[i].v * DIST_STRIDE]) {
+      out[k++] = i;
+    }
+  }
+  return k;
+}
+
+// Picks the widest kernels the CPU supports, the scalar ones when the vertex
+// ids do not fit the signed 32-bit gather indices
+inline const RelaxKernels &select_relax_kernels(size_t n) {
+  static const RelaxKernels scalar = {"scalar", pull_min_scalar,
+                                      push_candidates_scalar};
+  static const RelaxKernels avx2 = {"avx2", pull_min_avx2,
+                                    push_candidates_avx2};
+  static const RelaxKernels avx512 = {"avx512", pull_min_avx512,
+                                      push_candidates_avx512};
+  if (n >= (1ULL << 31)) {
+    return scalar;
+  }
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return avx512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return avx2;
+  }
+  return scalar;
+}
@@ -1,91 +1,226 @@
 #include "sssp.h"
 
-#include <functional>
-#include <numeric>
-
-#include "dijkstra.hpp"
-#include "backend/sqlite3_backend.hpp"
-#include "backend/postgres_backend.hpp"
-
-#include <regex>
-
 using namespace std;
 using namespace pbbs;
 
-// Taken from: https://stackoverflow.com/questions/874134/find-out-if-string-ends-with-another-string-in-c
-// All credit belongs to Joseph and tshepang
-inline bool ends_with(std::string const &value, std::string const &ending)
+template <class F>
+void SSSP::degree_sampling(size_t sz, F nth)
 {
-  if (ending.size() > value.size())
-    return false;
-  return std::equal(ending.rbegin(), ending.rend(), value.rbegin());
+  for (size_t i = 0; i < SSSP_SAMPLES; i++)
+  {
+    NodeId u = nth(hash32(deg_seed) % sz);
+    sample_deg[i] = G.offset[u + 1] - G.offset[u];
+    deg_seed++;
+  }
+  deg_samples = SSSP_SAMPLES;
 }
 
-inline bool starts_with(std::string const &value, std::string const &beginning)
+bool SSSP::choose_mode(size_t sz)
 {
-  if (beginning.size() > value.size())
-    return false;
-  return std::equal(beginning.begin(), beginning.end(), value.begin());
+  size_t deg_sum = 0;
+  for (size_t i = 0; i < deg_samples; i++)
+  {
+    deg_sum += sample_deg[i];
+  }
+  decision.frontier = sz;
+  decision.est_edges = deg_samples ? 1.0 * deg_sum / deg_samples * sz : 0;
+  decision.sparse_cost = sz + decision.est_edges;
+  decision.dense_cost = G.n / dense_alpha;
+  decision.sparse = decision.sparse_cost < decision.dense_cost;
+  return decision.sparse;
 }
 
-void SSSP::degree_sampling(size_t sz)
+void SSSP::trace(TracePhase phase, double start, size_t frontier)
 {
-  static uint32_t seed = 353442899;
-  for (size_t i = 0; i < SSSP_SAMPLES; i++)
-  {
-    NodeId u = que[cur][hash32(seed) % sz];
-    sample_deg[i] = G.offset[u + 1] - G.offset[u];
-    seed++;
-  }
+  TraceEvent e;
+  e.query = trace_query;
+  e.round = round;
+  e.phase = phase;
+  e.start = start;
+  e.duration = tracer->now() - start;
+  e.frontier = frontier;
+  e.threshold = round_th;
+  e.est_edges = decision.est_edges;
+  e.sparse_cost = decision.sparse_cost;
+  e.dense_cost = decision.dense_cost;
+  e.sparse = phase == trace_pack ? decision.sparse : sparse;
+  e.subrounds = round_subrounds;
+  tracer->record(e);
 }
 
 void SSSP::sparse_sampling(size_t sz)
 {
-  static uint32_t seed = 998244353;
   for (size_t i = 0; i < SSSP_SAMPLES; i++)
   {
-    NodeId u = que[cur][hash32(seed) % sz];
+    NodeId u = que[cur][hash32(sparse_seed) % sz];
     sample_dist[i] = info[u].dist;
-    seed++;
+    sparse_seed++;
   }
   sort(sample_dist, sample_dist + SSSP_SAMPLES);
 }
 
-size_t SSSP::dense_sampling()
+// Prefetches the state of the targets of edge [pf, to), advancing pf, so
+// that the loads run prefetch_dist edges ahead of the relaxation
+void SSSP::prefetch_neighbors(EdgeId &pf, EdgeId to)
 {
-	static uint32_t seed = 10086;
-  uint64_t num_sample = 0;
-  for (size_t i = 0; i < SSSP_SAMPLES;) {
-    num_sample++;
-    NodeId u = hash32(seed) % G.n;
-    if (info[u].fl & in_que) {
-      sample_dist[i] = info[u].dist;
-      i++;
+  for (; pf < to; pf++)
+  {
+    __builtin_prefetch(&info[G.edge[pf].v], 1);
+  }
+}
+
+// Software pipeline over the sparse frontier, run while vertex i is relaxed:
+// the offsets and state of the vertex 3 * PREFETCH_FRONTIER slots ahead, the
+// edges of the one 2 * PREFETCH_FRONTIER ahead and the targets of the first
+// prefetch_dist edges of the one PREFETCH_FRONTIER ahead are requested, so
+// every stage reads only lines the previous one brought in. Slots taken by
+// another worker already hold UINT_MAX and are skipped.
+void SSSP::prefetch_frontier(size_t i, size_t sz)
+{
+  constexpr size_t EDGES_PER_LINE = 64 / sizeof(Edge);
+  if (i + 3 * PREFETCH_FRONTIER < sz)
+  {
+    NodeId g = que[cur][i + 3 * PREFETCH_FRONTIER];
+    if (g < G.n)
+    {
+      __builtin_prefetch(&G.offset[g]);
+      __builtin_prefetch(&info[g]);
     }
-    seed++;
-		if(num_sample>=G.n) {
-			for(unsigned int k = i; k < SSSP_SAMPLES; k++) {
-				sample_dist[k] = UINT_MAX;
-			}
-			return 1.0 * i / G.n * G.n;
-		}
-	}
+  }
+  if (i + 2 * PREFETCH_FRONTIER < sz)
+  {
+    NodeId g = que[cur][i + 2 * PREFETCH_FRONTIER];
+    if (g < G.n)
+    {
+      EdgeId end = min<EdgeId>(G.offset[g] + prefetch_dist, G.offset[g + 1]);
+      for (EdgeId es = G.offset[g]; es < end; es += EDGES_PER_LINE)
+      {
+        __builtin_prefetch(&G.edge[es]);
+      }
+    }
+  }
+  if (i + PREFETCH_FRONTIER < sz)
+  {
+    NodeId g = que[cur][i + PREFETCH_FRONTIER];
+    if (g < G.n)
+    {
+      EdgeId pf = G.offset[g];
+      prefetch_neighbors(pf, min<EdgeId>(pf + prefetch_dist, G.offset[g + 1]));
+    }
+  }
+}
+
+// The kernels relax RELAX_CHUNK edges at a time, so the targets of a chunk
+// are requested one chunk ahead, together with the prefetch_dist edges after
+// it. The head of the first chunk was requested by prefetch_frontier in
+// sparse rounds.
+EdgeTy SSSP::pull_min(NodeId u, EdgeId _s, EdgeId _e)
+{
+  EdgeTy temp_dis = info[u].dist;
+  EdgeId pf = _s;
+  if (prefetch_dist)
+  {
+    prefetch_neighbors(pf, min<EdgeId>(_s + RELAX_CHUNK, _e));
+  }
+  for (EdgeId es = _s; es < _e; es += RELAX_CHUNK)
+  {
+    EdgeId ce = min<EdgeId>(es + RELAX_CHUNK, _e);
+    if (prefetch_dist)
+    {
+      prefetch_neighbors(pf, min<EdgeId>(ce + RELAX_CHUNK + prefetch_dist, _e));
+    }
+    temp_dis = kernels.pull_min(&G.edge[es], ce - es, &info[0].dist, temp_dis);
+  }
+  return temp_dis;
+}
+
+template <class F>
+void SSSP::push_neighbors(NodeId u, EdgeId _s, EdgeId _e, F on_improve)
+{
+  // A stale du only yields weaker candidates, if u improves later it is
+  // added to the frontier again and relaxed with its new distance
+  EdgeTy du = info[u].dist;
+  uint32_t idx[RELAX_CHUNK];
+  EdgeId pf = _s;
+  if (prefetch_dist)
+  {
+    prefetch_neighbors(pf, min<EdgeId>(_s + RELAX_CHUNK, _e));
+  }
+  for (EdgeId es = _s; es < _e; es += RELAX_CHUNK)
+  {
+    EdgeId ce = min<EdgeId>(es + RELAX_CHUNK, _e);
+    if (prefetch_dist)
+    {
+      prefetch_neighbors(pf, min<EdgeId>(ce + RELAX_CHUNK + prefetch_dist, _e));
+    }
+    size_t k = kernels.push_candidates(&G.edge[es], ce - es, &info[0].dist,
+                                       du, idx);
+    for (size_t j = 0; j < k; j++)
+    {
+      NodeId v = G.edge[es + idx[j]].v;
+      EdgeTy w = G.edge[es + idx[j]].w;
+      if (write_min(&info[v].dist, du + w,
+                    [](EdgeTy w1, EdgeTy w2)
+                    { return w1 < w2; }))
+      {
+        on_improve(v);
+      }
+    }
+  }
+}
+
+size_t SSSP::frontier_rank()
+{
+  auto word_cnt = dseq(frontier.num_words(), [&](size_t w) -> NodeId
+                       { return frontier.word_count(w); });
+  return scan_(word_cnt, que_num.slice(),
+               monoid([](NodeId a, NodeId b)
+                      { return a + b; },
+                      0));
+}
+
+NodeId SSSP::frontier_select(size_t r)
+{
+  // que_num holds the rank of the first set bit of every word after
+  // frontier_rank, the word holding rank r is the last one starting at or
+  // before r
+  size_t w = upper_bound(que_num.begin(),
+                         que_num.begin() + frontier.num_words(), r) -
+             que_num.begin() - 1;
+  return w * Bitmap::WORD_BITS +
+         Bitmap::select(frontier.word(w), r - que_num[w]);
+}
+
+size_t SSSP::dense_sampling()
+{
+  size_t sz = frontier_rank();
+  if (sz == 0) {
+    fill(sample_dist, sample_dist + SSSP_SAMPLES, UINT_MAX);
+    deg_samples = 0;
+    return 0;
+  }
+  for (size_t i = 0; i < SSSP_SAMPLES; i++) {
+    NodeId u = frontier_select(hash32(dense_seed) % sz);
+    sample_dist[i] = info[u].dist;
+    sample_deg[i] = G.offset[u + 1] - G.offset[u];
+    dense_seed++;
+  }
+  deg_samples = SSSP_SAMPLES;
   sort(sample_dist, sample_dist + SSSP_SAMPLES);
-  return 1.0 * SSSP_SAMPLES / num_sample * G.n;
+  return sz;
 }
 
 void SSSP::relax(size_t sz)
 {
   if (sparse)
   {
-    size_t qsize[doubling], cnt[doubling];
-    qsize[0] = cnt[0] = cnt[1] = 0;
+    qsize[0] = qcnt[0] = qcnt[1] = 0;
     qsize[1] = MIN_QUEUE;
     int db_len = 2;
     for (size_t s = MIN_QUEUE * 2; s <= max_queue; s *= 2)
     {
       qsize[db_len] = s;
-      cnt[db_len] = 0;
+      qcnt[db_len] = 0;
       db_len++;
     }
 
@@ -109,7 +244,7 @@ void SSSP::relax(size_t sz)
           hash32(u) % (qsize[t_pt] - qsize[t_pt - 1]) + qsize[t_pt - 1];
       // Find our position in the queue while competing with threads inserting
       // an element with a similiar hash
-
+      size_t probes = 0;
       while (que[nxt][pos] != UINT_MAX ||
              !atomic_compare_and_swap(&que[nxt][pos], UINT_MAX, u))
       {
@@ -118,13 +253,29 @@ void SSSP::relax(size_t sz)
         {
           pos = qsize[t_pt - 1];
         }
+        if (++probes < QUEUE_PROBES)
+        {
+          continue;
+        }
+        // The segment is close to full, move on to the next one or, after
+        // the last one, to the bitmap
+        if (t_pt + 1 == db_len)
+        {
+          overflow = true;
+          frontier.set(u);
+          return;
+        }
+        atomic_compare_and_swap(&pt, t_pt, t_pt + 1);
+        t_pt = pt;
+        pos = hash32(u) % (qsize[t_pt] - qsize[t_pt - 1]) + qsize[t_pt - 1];
+        probes = 0;
       }
       // The queue should be half occupied when we have EXP_SAMPLES
       size_t len = qsize[t_pt] - qsize[t_pt - 1];
       size_t rate = len / (2 * EXP_SAMPLES);
       if (pos % rate == 0)
       {
-        int ret = fetch_and_add(&cnt[t_pt], 1);
+        int ret = fetch_and_add(&qcnt[t_pt], 1);
         if (ret + 1 == EXP_SAMPLES && t_pt + 1 < db_len)
         {
           atomic_compare_and_swap(&pt, t_pt, t_pt + 1);
@@ -138,40 +289,29 @@ void SSSP::relax(size_t sz)
       _e += G.offset[u];
       if (G.symmetrized)
       {
-        EdgeTy temp_dis = info[u].dist;
-        for (EdgeId es = _s; es < _e; es++)
-        {
-          NodeId v = G.edge[es].v;
-          EdgeTy w = G.edge[es].w;
-          temp_dis = min(temp_dis, info[v].dist + w);
-        }
-        if (write_min(&info[u].dist, temp_dis,
+        if (write_min(&info[u].dist, pull_min(u, _s, _e),
                       [](EdgeTy w1, EdgeTy w2)
                       { return w1 < w2; }))
         {
           add(u);
         }
       }
-      metrics->log_node_relax(u,_e-_s);
-      for (EdgeId es = _s; es < _e; es++)
+      if (metrics)
       {
-        NodeId v = G.edge[es].v;
-        EdgeTy w = G.edge[es].w;
-        if (write_min(&info[v].dist, info[u].dist + w,
-                      [](EdgeTy w1, EdgeTy w2)
-                      { return w1 < w2; }))
-        {
-          add(v);
-        }
+        metrics->log_node_relax(u, _e - _s);
       }
+      push_neighbors(u, _s, _e, [&](NodeId v)
+                     { add(v); });
     };
-    degree_sampling(sz);
- 
-    bool super_sparse = false;
     EdgeTy th;
     if (algo == rho_stepping)
     {
+      double t0 = trace_start();
       sparse_sampling(sz);
+      if (tracer)
+      {
+        trace(trace_sampling, t0, sz);
+      }
       int rate = min(SSSP_SAMPLES - 1, SSSP_SAMPLES * param / sz);
       th = sample_dist[rate];
     }
@@ -184,64 +324,23 @@ void SSSP::relax(size_t sz)
     {
       th = UINT_MAX;
     }
+    round_th = th;
+    round_subrounds = 1;
     parallel_for(0, sz, [&](size_t i)
                  {
       NodeId f = que[cur][i];
-        
+      if (prefetch_dist) {
+        prefetch_frontier(i, sz);
+      }
       que[cur][i] = UINT_MAX;
       if (info[f].dist > th) {
         add(f,true);
       } else {
         size_t _n = G.offset[f + 1] - G.offset[f];
-        if (super_sparse && _n < BLOCK_SIZE) {
-          sequence<NodeId> q(BLOCK_SIZE);
-          int front = 0, rear = 0;
-          q[rear++] = f;
-          while (front < rear && rear < BLOCK_SIZE) {
-            NodeId u = q[front];
-            size_t deg = G.offset[u + 1] - G.offset[u];
-            if (deg >= BLOCK_SIZE) {
-              break;
-            }
-            front++;
-            if (algo == delta_stepping && info[u].dist > th) {
-              add(u);
-              continue;
-            }
-            if (G.symmetrized) {
-							std::exit(-1);
-              EdgeTy temp_dis = info[u].dist;
-              for (EdgeId es = G.offset[u]; es < G.offset[u + 1]; es++) {
-                NodeId v = G.edge[es].v;
-                EdgeTy w = G.edge[es].w;
-                temp_dis = min(temp_dis, info[v].dist + w);
-              }
-              write_min(&info[u].dist, temp_dis,
-                        [](EdgeTy w1, EdgeTy w2) { return w1 < w2; });
-            }
-            for (EdgeId es = G.offset[u]; es < G.offset[u + 1]; es++) {
-              NodeId v = G.edge[es].v;
-              EdgeTy w = G.edge[es].w;
-              if (write_min(&info[v].dist, info[u].dist + w,
-                            [](EdgeTy w1, EdgeTy w2) { return w1 < w2; })) {
-                if (rear < BLOCK_SIZE) {
-                  q[rear++] = v;
-                } else {
-                  add(v);
-                }
-              }
-            }
-          }
-          while (front < rear) {
-            NodeId u = q[front++];
-            add(u);
-          }
-        } else {
-          sliced_for(_n, BLOCK_SIZE,
-                     [&]([[maybe_unused]] size_t j, size_t _s, size_t _e) {
-                       relax_neighbors(f, _s, _e);
-                     });
-        }
+        sliced_for(_n, BLOCK_SIZE,
+                   [&]([[maybe_unused]] size_t j, size_t _s, size_t _e) {
+                     relax_neighbors(f, _s, _e);
+                   });
       } });
     que_size = qsize[pt];
   }
@@ -253,53 +352,37 @@ void SSSP::relax(size_t sz)
       _e += G.offset[u];
       if (G.symmetrized)
       {
-        EdgeTy temp_dis = info[u].dist;
-        for (size_t es = _s; es < _e; es++)
-        {
-          NodeId v = G.edge[es].v;
-          EdgeTy w = G.edge[es].w;
-          temp_dis = min(temp_dis, info[v].dist + w);
-        }
-        if (write_min(&info[u].dist, temp_dis,
-                      [](EdgeTy w1, EdgeTy w2)
-                      { return w1 < w2; }))
-        {
-      		if (!(info[u].fl & in_que) &&
-          	atomic_compare_and_swap(&info[u].fl, info[u].fl,
-                                   info[u].fl | in_que))
-      		{
-						if(metrics) {
-							metrics->log_node_add(u);
-						}
-					}
-        }
-      }
-      for (size_t es = _s; es < _e; es++)
-      {
-        NodeId v = G.edge[es].v;
-        EdgeTy w = G.edge[es].w;
-        if (write_min(&info[v].dist, info[u].dist + w,
+        if (write_min(&info[u].dist, pull_min(u, _s, _e),
                       [](EdgeTy w1, EdgeTy w2)
                       { return w1 < w2; }))
         {
-					if (!(info[v].fl & in_que) &&
-          	atomic_compare_and_swap(&info[v].fl, info[v].fl,
-                                   info[v].fl | in_que))
-      		{
-						if(metrics) {
-							metrics->log_node_add(v);
-						}
+          if (frontier.set(u) && metrics)
+          {
+            metrics->log_node_add(u);
           }
         }
       }
+      push_neighbors(u, _s, _e, [&](NodeId v)
+                     {
+        if (frontier.set(v) && metrics)
+        {
+          metrics->log_node_add(v);
+        } });
     };
 
     int subround = 1;
 		bool first_round = true;
     while (true)
     {
+      double t0 = trace_start();
       size_t est_size = dense_sampling();
-      if (est_size < G.n / sd_scale)
+      if (tracer)
+      {
+        trace(trace_sampling, t0, est_size);
+      }
+      // pack has just chosen dense mode for this round, only reconsider the
+      // decision once the frontier has been relaxed
+      if (subround > 1 && choose_mode(est_size) && est_size <= max_queue)
       {
         break;
       }
@@ -326,18 +409,26 @@ void SSSP::relax(size_t sz)
       {
         th = UINT_MAX;
       }
-			if(!first_round) {
+      round_th = th;
+      round_subrounds = subround;
+			if(!first_round && metrics) {
     		metrics->incAlgorithmStep();
 			}
-      parallel_for(0, G.n, [&](size_t u)
+      parallel_for(0, frontier.num_words(), [&](size_t w)
                    {
-        if (info[u].dist <= th && (info[u].fl & in_que)) {
-          info[u].fl &= ~in_que;
-          size_t _n = G.offset[u + 1] - G.offset[u];
-          sliced_for(_n, BLOCK_SIZE,
-                     [&]([[maybe_unused]] size_t j, size_t _s, size_t _e) {
-                       relax_neighbors(u, _s, _e);
-                     });
+        // Bits set by this subround are left for the next one
+        uint64_t word = frontier.word(w);
+        while (word) {
+          NodeId u = w * Bitmap::WORD_BITS + __builtin_ctzll(word);
+          word &= word - 1;
+          if (info[u].dist <= th) {
+            frontier.reset(u);
+            size_t _n = G.offset[u + 1] - G.offset[u];
+            sliced_for(_n, BLOCK_SIZE,
+                       [&]([[maybe_unused]] size_t j, size_t _s, size_t _e) {
+                         relax_neighbors(u, _s, _e);
+                       });
+          }
         } });
 			first_round = false;
       subround++;
@@ -348,8 +439,32 @@ void SSSP::relax(size_t sz)
 int SSSP::pack()
 {
   size_t nxt_sz = 0;
-  bool next_sparse;
-  if (sparse)
+  if (sparse && overflow)
+  {
+    // Part of the next frontier is in the bitmap already, move the rest
+    // there and continue densely
+    parallel_for(0, que_size, [&](size_t i)
+                 {
+      NodeId u = que[nxt][i];
+      if (u != UINT_MAX) {
+        que[nxt][i] = UINT_MAX;
+        frontier.set(u);
+      } });
+    parallel_for(0, frontier.num_words(), [&](size_t w)
+                 {
+      uint64_t word = frontier.word(w);
+      while (word) {
+        info[w * Bitmap::WORD_BITS + __builtin_ctzll(word)].fl &= ~to_add;
+        word &= word - 1;
+      } });
+    overflow = false;
+    nxt_sz = frontier_rank();
+    degree_sampling(nxt_sz, [&](size_t i)
+                    { return frontier_select(i); });
+    choose_mode(nxt_sz);
+    decision.sparse = false;
+  }
+  else if (sparse)
   {
     parallel_for(0, que_size,
                  [&](size_t i)
@@ -358,61 +473,61 @@ int SSSP::pack()
                           monoid([](NodeId a, NodeId b)
                                  { return a + b; },
                                  0));
-    next_sparse = (nxt_sz < G.n / sd_scale);
-    if (next_sparse)
+    NodeId *tmp = pack_buf.begin();
+    parallel_for(0, que_size, [&](size_t i)
+                 {
+      if (que[nxt][i] != UINT_MAX) {
+        NodeId u = que[nxt][i];
+        que[nxt][i] = UINT_MAX;
+        info[u].fl ^= to_add;
+        tmp[que_num[i]] = u;
+      } });
+    if (nxt_sz)
+    {
+      degree_sampling(nxt_sz, [&](size_t i)
+                      { return tmp[i]; });
+    }
+    if (choose_mode(nxt_sz))
     {
-      sequence<NodeId> tmp(nxt_sz);
-      parallel_for(0, que_size, [&](size_t i)
-                   {
-        if (que[nxt][i] != UINT_MAX) {
-          NodeId u = que[nxt][i];
-          que[nxt][i] = UINT_MAX;
-          info[u].fl ^= to_add;
-          tmp[que_num[i]] = u;
-        } });
       parallel_for(0, nxt_sz, [&](size_t i)
                    { que[nxt][i] = tmp[i]; });
     }
     else
     {
-
-
-      parallel_for(0, que_size, [&](size_t i)
-                   {
-        if (que[nxt][i] != UINT_MAX) {
-          NodeId u = que[nxt][i];
-          que[nxt][i] = UINT_MAX;
-          info[u].fl |= in_que;
-          info[u].fl ^= to_add;
-        } });
+      parallel_for(0, nxt_sz, [&](size_t i)
+                   { frontier.set(tmp[i]); });
     }
   }
   else
   { // dense
-    auto que_num0 = dseq(
-        G.n, [&](size_t i) -> NodeId
-        { return (info[i].fl & in_que) ? 1 : 0; });
-    nxt_sz = scan_(que_num0, que_num.slice(),
-                   monoid([](NodeId a, NodeId b)
-                          { return a + b; },
-                          0));
-    next_sparse = (nxt_sz < G.n / sd_scale);
-    if (next_sparse)
+    nxt_sz = frontier_rank();
+    if (nxt_sz)
+    {
+      degree_sampling(nxt_sz, [&](size_t i)
+                      { return frontier_select(i); });
+    }
+    if (choose_mode(nxt_sz) && nxt_sz > max_queue)
+    {
+      // Only switch back once the frontier fits the queue
+      decision.sparse = false;
+    }
+    if (decision.sparse)
     {
-      parallel_for(0, G.n, [&](size_t i)
+      parallel_for(0, frontier.num_words(), [&](size_t w)
                    {
-        if (info[i].fl & in_que) {
-          info[i].fl &= ~in_que;
-          que[nxt][que_num[i]] = i;
-        } });
+        uint64_t word = frontier.word(w);
+        for (size_t k = que_num[w]; word; k++) {
+          que[nxt][k] = w * Bitmap::WORD_BITS + __builtin_ctzll(word);
+          word &= word - 1;
+        }
+        frontier.clear_word(w); });
     }
   }
+  sparse = decision.sparse;
   swap(cur, nxt);
   return nxt_sz;
 }
 
-void SSSP::reset_timer() { t_all.reset(); }
-
 void SSSP::sssp(int s, EdgeTy *_dist)
 {
   if (!G.weighted)
@@ -422,6 +537,10 @@ void SSSP::sssp(int s, EdgeTy *_dist)
   }
   t_all.start();
   cur = 0, nxt = 1;
+  // every query samples the same sequence, so runs are reproducible
+  deg_seed = DEG_SEED;
+  sparse_seed = SPARSE_SEED;
+  dense_seed = DENSE_SEED;
   if (algo == delta_stepping)
   {
     delta = param;
@@ -433,242 +552,76 @@ void SSSP::sssp(int s, EdgeTy *_dist)
   parallel_for(0, info.size(),
                [&](size_t i)
                { info[i] = Information(INT_MAX / 2, 0); });
+  frontier.clear();
 
   size_t sz = 1;
   que[cur][0] = s;
   info[s].dist = 0;
   sparse = true;
+  overflow = false;
+  decision = ModeDecision();
   if (metrics)
   {
     metrics->log_node_add(s);
   }
 
-  while (sz)
+  round = 0;
+  round_th = 0;
+  round_subrounds = 0;
+  if (tracer)
   {
-    relax(sz);
-    sz = pack();
-    if (sz >= G.n / sd_scale)
-    {
-      sparse = false;
-    }
-    else
-    {
-      sparse = true;
-    };
-    metrics->incAlgorithmStep();
+    trace_query = tracer->begin_query();
   }
-  t_all.stop();
-  parallel_for(0, G.n, [&](size_t i)
-               { _dist[i] = info[i].dist; });
-}
 
-int main(int argc, char *argv[])
-{
-  if (argc == 1)
+  // every round reads the counters twice, between relax and pack and after
+  // pack, and the reads are left out of the query time
+  if (perf)
   {
-    fprintf(
-        stderr,
-        "Usage: %s [-i input_file] [-p parameter] [-m metrics_file] [-w] [-s] [-v] [-a "
-        "algorithm]\n"
-        "Options:\n"
-        "\t-i,\tinput file path\n"
-        "\t-m,\tmetrics file path\n"
-        "\t-p,\tparameter(e.g. delta, rho)\n"
-        "\t-w,\tweighted input graph\n"
-        "\t-s,\tsymmetrized input graph\n"
-        "\t-v,\tverify result\n"
-        "\t-r,\tnum rounds per source vertex\n"
-        "\t-n,\tnum source vertices per graph\n"
-        "\t-a,\talgorithm: [rho-stepping] [delta-stepping] [bellman-ford]\n"
-				"\t-g,\tregime: additional information\n",
-        argv[0]);
-    exit(EXIT_FAILURE);
+    t_all.stop();
+    perf->start(perf_relax);
+    t_all.start();
   }
-  char c;
-  bool weighted = false;
-  bool symmetrized = false;
-  bool verify = false;
-  std::string METRICS_PATH;
-  int NUM_SOURCES = 1000;
-  int NUM_ROUNDS = 10;
-
-  size_t param = 1 << 21;
-  Algorithm algo = rho_stepping;
-  const char *ALGORITHM = nullptr;
-	const char *REGIME = "unspecified";
-  while ((c = getopt(argc, argv, "i:p:g:a:n:r:m:wsv")) != -1)
+  while (sz)
   {
-    switch (c)
+    double t0 = trace_start();
+    relax(sz);
+    if (perf)
     {
-    case 'i':
-      FILEPATH = optarg;
-      break;
-    case 'p':
-      param = atol(optarg);
-      break;
-    case 'n':
-      NUM_SOURCES = atol(optarg);
-      break;
-		case 'g':
-			REGIME = optarg;
-			break;
-    case 'r':
-      NUM_ROUNDS = atol(optarg);
-      break;
-    case 'a':
-      if (!strcmp(optarg, "rho-stepping"))
-      {
-        algo = rho_stepping;
-        ALGORITHM = optarg;
-      }
-      else if (!strcmp(optarg, "delta-stepping"))
-      {
-        algo = delta_stepping;
-        ALGORITHM = optarg;
-      }
-      else if (!strcmp(optarg, "bellman-ford"))
-      {
-        algo = bellman_ford;
-        ALGORITHM = optarg;
-      }
-      else
-      {
-        fprintf(stderr, "Error: Unknown algorithm %s\n", optarg);
-        exit(EXIT_FAILURE);
-      }
-      break;
-    case 'w':
-      weighted = true;
-      break;
-    case 's':
-      symmetrized = true;
-      break;
-    case 'v':
-      verify = true;
-      break;
-    case 'm':
-      METRICS_PATH = optarg;
-      break;
-    default:
-      fprintf(stderr, "Error: Unknown option %c\n", optopt);
-      exit(EXIT_FAILURE);
+      t_all.stop();
+      perf->next(perf_relax, perf_pack);
+      t_all.start();
     }
-  }
-  Graph G(weighted, symmetrized);
-
-  printf("Info: Reading graph\n");
-  G.read_graph(FILEPATH);
-  if (!weighted)
-  {
-    printf("Info: Generating edge weights\n");
-    G.generate_weight();
-    //G.exponential_generate_weight();
-  }
-
-  SSSPMetrics *metrics_ptr = nullptr;
-  if (METRICS_PATH != "")
-  {
-    std::string filename = FILEPATH;
-    if (ends_with(filename, ".adj"))
+    if (tracer)
     {
-      std::ifstream inputGraph(filename);
-      std::stringstream buffer;
-      buffer << inputGraph.rdbuf();
-      BackendInterface *backend = nullptr;
-      if (starts_with(METRICS_PATH, "sqlite:"))
-      {
-        METRICS_PATH = METRICS_PATH.substr(strlen("sqlite:"));
-        backend = new Sqlite3Backend(METRICS_PATH, buffer.str(), ALGORITHM, param, REGIME);
-      }
-      else if (starts_with(METRICS_PATH, "postgres:"))
+      trace(trace_relax, t0, sz);
+      t0 = tracer->now();
+    }
+    size_t nxt_sz = pack();
+    if (perf)
+    {
+      t_all.stop();
+      if (nxt_sz)
       {
-        std::regex re("postgres:(.*):(.*)@(.*):(.*)/(.*)");
-        std::cmatch m;
-        if (std::regex_match(METRICS_PATH.c_str(), m, re))
-        {
-          std::string user = m[1];
-          std::string password = m[2];
-          std::string host = m[3];
-          int port = std::atoi(m[4].str().c_str());
-          std::string database = m[5];
-          backend = new PostgresBackend(user, password, host, port, database, buffer.str(), ALGORITHM, param);
-        }
-        else
-        {
-          std::cerr << "The format does not conform to postgres. Format must be like: postgres:username:password@127.0.0.1:5432/database_name" << std::endl;
-          std::exit(-1);
-        }
+        perf->next(perf_pack, perf_relax);
       }
       else
       {
-        std::cerr << "Fatal error: Only sqlite as backend supported for now." << std::endl;
-        std::exit(-1);
-      }
-
-      if (backend == nullptr)
-      {
-        std::cerr << "Could not initialise backend" << std::endl;
-        std::exit(-1);
+        perf->stop(perf_pack);
       }
-
-      metrics_ptr = new SSSPMetrics(backend);
+      t_all.start();
     }
-    else
+    if (tracer)
     {
-      std::cerr << "Only adj files are supported for now. Aborting..." << std::endl;
-      std::exit(-1);
+      trace(trace_pack, t0, nxt_sz);
     }
-  }
-
-  SSSP solver(G, algo, metrics_ptr, param);
-  int sd_scale = G.m / G.n;
-  solver.set_sd_scale(sd_scale);
-  printf("Running on %s: |V|=%zu, |E|=%zu, param=%zu, num_src=%d, "
-         "num_round=%d\n",
-         FILEPATH, G.n, G.m, param, NUM_SOURCES, NUM_ROUNDS);
-  EdgeTy *dijkstra_dist = new EdgeTy[G.n];
-  EdgeTy *my_dist = new EdgeTy[G.n];
-
-  for (int v = 0; v < NUM_SOURCES; v++)
-  {
-    int s = hash32(v) % G.n;
-    // printf("Source: %d; Iteration: %d/%d\n", s,v+1,NUM_SOURCES);
-    vector<double> sssp_time;
-    // first time warmup
-    solver.reset_timer();
-    solver.sssp(s, my_dist);
-    // printf("warmup round (not counted): %f\n", solver.t_all.get_total());
-    solver.metrics->reset_round();
-
-    for (int i = 0; i < NUM_ROUNDS; i++)
-    {
-      solver.reset_timer();
-      solver.sssp(s, my_dist);
-      sssp_time.push_back(solver.t_all.get_total());
-      solver.metrics->reset_round(s);
-
-      printf("Source %d; Iteration %d/%d: Round %d/%d: %fs                                 \r", s, v + 1, NUM_SOURCES, i + 1, NUM_ROUNDS, solver.t_all.get_total());
-      fflush(stdout);
-    }
-    sort(begin(sssp_time), end(sssp_time));
-    // printf("median running time: %f\n", sssp_time[(sssp_time.size() - 1) / 2]);
-    // printf("average running time: %f\n",
-    //        accumulate(begin(sssp_time), end(sssp_time), 0.0) / NUM_ROUNDS);
-
-    if (verify)
+    sz = nxt_sz;
+    round++;
+    if (metrics)
     {
-      printf("Info: Running verifier\n");
-      verifier(s, G, my_dist);
+      metrics->incAlgorithmStep();
     }
   }
-  printf("\n");
-  delete[] dijkstra_dist;
-  delete[] my_dist;
-  if (metrics_ptr)
-  {
-    delete metrics_ptr;
-    metrics_ptr = nullptr;
-  }
-
-  return 0;
+  t_all.stop();
+  parallel_for(0, G.n, [&](size_t i)
+               { _dist[i] = info[i].dist; });
 }
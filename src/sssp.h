@@ -1,5 +1,9 @@
 #pragma once
+#include "bitmap.hpp"
 #include "graph.hpp"
+#include "perf_counters.hpp"
+#include "simd_relax.hpp"
+#include "trace.hpp"
 #include "../pbbslib/get_time.h"
 #include "../pbbslib/parallel.h"
 #include "../pbbslib/sequence.h"
@@ -8,17 +12,29 @@
 using namespace std;
 using namespace pbbs;
 
-char const *FILEPATH = nullptr;
-constexpr uint32_t in_que = 1;
 constexpr uint32_t to_add = 2;
 
 constexpr int BLOCK_SIZE = 1 << 12;
 constexpr size_t MIN_QUEUE = 1 << 14;
+// Failed probes after which an insertion leaves its hash queue segment
+constexpr size_t QUEUE_PROBES = 1 << 10;
 constexpr size_t DEG_THLD = 0;
 constexpr size_t SSSP_SAMPLES = 1000;
 constexpr size_t EXP_SAMPLES = 100;
+constexpr size_t PREFETCH_DISTANCE = 16;
+constexpr size_t PREFETCH_FRONTIER = 4;
+constexpr uint32_t DEG_SEED = 353442899;
+constexpr uint32_t SPARSE_SEED = 998244353;
+constexpr uint32_t DENSE_SEED = 10086;
 
-enum Algorithm { rho_stepping = 0, delta_stepping, bellman_ford };
+enum Algorithm {
+  rho_stepping = 0,
+  delta_stepping,
+  bellman_ford,
+  bucket_delta_stepping,
+  radius_stepping,
+  bfs
+};
 
 struct Information {
   EdgeTy dist;
@@ -26,49 +42,137 @@ struct Information {
   Information() : dist(INT_MAX), fl(0) {}
   Information(EdgeTy _dist, uint32_t _fl) : dist(_dist), fl(_fl) {}
 };
+static_assert(sizeof(Information) == sizeof(EdgeTy) * DIST_STRIDE,
+              "relax kernels read distances with the stride of Information");
+
+// Interface shared by the engines selectable with -a
+class SSSPSolver {
+ public:
+  virtual ~SSSPSolver() {}
+  virtual void sssp(int s, EdgeTy *dist) = 0;
+  // Bytes of solver state besides the graph
+  virtual size_t memory_bytes() const = 0;
+  // Another solver for the same graph that shares the per-graph
+  // preprocessing of this one and has its own query state, for answering
+  // queries concurrently. Metrics, tracer and counters are not carried over.
+  virtual SSSPSolver *clone() const = 0;
+  void reset_timer() { t_all.reset(); }
+  timer t_all;
+};
 
-class SSSP {
+// Direction-optimization cost model behind the sparse/dense switch. A sparse
+// round costs one queue slot per frontier vertex plus one relaxation per
+// out-edge, a dense round scans every vertex once. The estimates of the last
+// decision are kept so that they can be traced.
+struct ModeDecision {
+  size_t frontier = 0;
+  size_t est_edges = 0;
+  size_t sparse_cost = 0;
+  size_t dense_cost = 0;
+  bool sparse = true;
+};
+
+class SSSP : public SSSPSolver {
  private:
   const Graph &G;
   Algorithm algo;
   bool sparse;
   int cur, nxt;
   int doubling;
-  int sd_scale = 1;
+  double dense_alpha = 1.0;
+  size_t prefetch_dist = PREFETCH_DISTANCE;
   EdgeTy delta;
   EdgeTy sample_dist[SSSP_SAMPLES];
   size_t sample_deg[SSSP_SAMPLES];
+  size_t deg_samples;
+  uint32_t deg_seed, sparse_seed, dense_seed;
+  ModeDecision decision;
   size_t que_size;
   size_t param;
   size_t max_queue;
+  // Set when the last queue segment was full and vertices went to the
+  // frontier bitmap instead, the next round has to be dense
+  bool overflow;
   sequence<Information> info;
   sequence<NodeId> que[2];
+  // Prefix counts of the queue in sparse packs and of the bitmap words in
+  // dense ones
   sequence<NodeId> que_num;
+  // Dense frontier, one bit per vertex
+  Bitmap frontier;
+  // Scratch space reused by every round: the compacted queue of a sparse
+  // pack and the segment bounds and fill samples of the hash queue
+  sequence<NodeId> pack_buf;
+  sequence<size_t> qsize, qcnt;
+  const RelaxKernels &kernels;
+  // Optional phase tracing, round_th and round_subrounds describe the last
+  // relax for its trace event
+  Tracer *tracer = nullptr;
+  uint32_t trace_query, round;
+  EdgeTy round_th;
+  uint32_t round_subrounds;
+  // Optional hardware counters of the relax and pack phases, -PP
+  PerfCounters *perf = nullptr;
 
-
-  void degree_sampling(size_t sz);
+  template <class F>
+  void degree_sampling(size_t sz, F nth);
+  bool choose_mode(size_t sz);
+  void prefetch_neighbors(EdgeId &pf, EdgeId to);
+  void prefetch_frontier(size_t i, size_t sz);
+  EdgeTy pull_min(NodeId u, EdgeId _s, EdgeId _e);
+  template <class F>
+  void push_neighbors(NodeId u, EdgeId _s, EdgeId _e, F on_improve);
+  size_t frontier_rank();
+  NodeId frontier_select(size_t r);
   void sparse_sampling(size_t sz);
   size_t dense_sampling();
   void relax(size_t sz);
   int pack();
+  double trace_start() const { return tracer ? tracer->now() : 0; }
+  void trace(TracePhase phase, double start, size_t frontier);
 
  public:
   SSSP() = delete;
   SSSP(const Graph &_G, Algorithm _algo, SSSPMetrics *_mets, size_t _param = 1 << 21)
-      : G(_G), algo(_algo), param(_param), metrics(_mets) {
-    max_queue = 1ULL << (static_cast<int>(ceil(log2(G.n)))+1);
+      : G(_G), algo(_algo), param(_param),
+        kernels(select_relax_kernels(_G.n)), metrics(_mets) {
+    // A sparse round holds at most a small fraction of the vertices, larger
+    // frontiers overflow into the bitmap, so the queues take n/4 to n/2
+    // entries instead of 2n to 4n
+    max_queue = max<size_t>(
+        MIN_QUEUE, 1ULL << max(static_cast<int>(ceil(log2(G.n))) - 2, 0));
     doubling = ceil(log2(max_queue / MIN_QUEUE)) + 2;
     info = sequence<Information>(G.n);
-    que[0] = que[1] = sequence<NodeId>(max_queue);
-    que_num = sequence<NodeId>(max_queue);
+    que[0] = sequence<NodeId>(max_queue);
+    que[1] = sequence<NodeId>(max_queue);
+    frontier = Bitmap(G.n);
+    que_num = sequence<NodeId>(max(max_queue, frontier.num_words()));
+    pack_buf = sequence<NodeId>(max_queue);
+    qsize = sequence<size_t>(doubling);
+    qcnt = sequence<size_t>(doubling);
   }
-  void sssp(int s, EdgeTy *dist);
-  void reset_timer();
-  void set_sd_scale(int x) { 
-    if(x>0) {
-      sd_scale = x;
-    } 
+  void sssp(int s, EdgeTy *dist) override;
+  SSSPSolver *clone() const override {
+    SSSP *lane = new SSSP(G, algo, nullptr, param);
+    lane->prefetch_dist = prefetch_dist;
+    lane->dense_alpha = dense_alpha;
+    return lane;
   }
-  timer t_all;
+  size_t memory_bytes() const override {
+    return info.size() * sizeof(Information) +
+           (que[0].size() + que[1].size() + que_num.size() + pack_buf.size()) *
+               sizeof(NodeId) +
+           (qsize.size() + qcnt.size()) * sizeof(size_t) + frontier.bytes();
+  }
+  void set_dense_alpha(double x) {
+    if (x > 0) {
+      dense_alpha = x;
+    }
+  }
+  const ModeDecision &last_decision() const { return decision; }
+  const char *kernel_name() const { return kernels.name; }
+  void set_prefetch_distance(size_t x) { prefetch_dist = x; }
+  void set_tracer(Tracer *t) { tracer = t; }
+  void set_perf_counters(PerfCounters *p) { perf = p; }
   SSSPMetrics *metrics;
 };
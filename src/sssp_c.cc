@@ -0,0 +1,84 @@
+#include "sssp_c.h"
+
+#include "generators.hpp"
+#include "libsssp.hpp"
+
+struct sssp_graph {
+  Graph G;
+  sssp_graph(bool weighted, bool symmetrized) : G(weighted, symmetrized) {}
+};
+
+struct sssp_solver {
+  const sssp_graph *graph;
+  SSSPSolver *solver;
+};
+
+sssp_graph *sssp_graph_load(const char *path, int weighted, int symmetrized) {
+  sssp_graph *graph = new sssp_graph(weighted, symmetrized);
+  graph->G.read_graph(path);
+  if (!weighted) {
+    graph->G.generate_weight();
+  }
+  return graph;
+}
+
+sssp_graph *sssp_graph_generate(const char *spec, int symmetrized) {
+  sssp_graph *graph = new sssp_graph(true, symmetrized);
+  generate_graph(graph->G, spec);
+  return graph;
+}
+
+sssp_graph *sssp_graph_from_csr(uint64_t n, uint64_t m, const uint64_t *offsets,
+                                const uint32_t *targets,
+                                const uint32_t *weights, int symmetrized) {
+  sssp_graph *graph = new sssp_graph(true, symmetrized);
+  Graph &G = graph->G;
+  G.n = n;
+  G.m = m;
+  G.offset = sequence<EdgeId>(n + 1);
+  G.edge = sequence<Edge>(m);
+  parallel_for(0, n + 1, [&](size_t i) { G.offset[i] = offsets[i]; });
+  parallel_for(0, m, [&](size_t i) {
+    G.edge[i] = Edge(targets[i], weights ? weights[i] : 1);
+  });
+  return graph;
+}
+
+uint64_t sssp_graph_num_vertices(const sssp_graph *graph) { return graph->G.n; }
+
+uint64_t sssp_graph_num_edges(const sssp_graph *graph) { return graph->G.m; }
+
+void sssp_graph_free(sssp_graph *graph) { delete graph; }
+
+sssp_solver *sssp_solver_create(const sssp_graph *graph, const char *algorithm,
+                                uint64_t param) {
+  Algorithm algo;
+  if (!parse_algorithm(algorithm, algo)) {
+    return nullptr;
+  }
+  SolverOptions opt;
+  opt.param = param;
+  return new sssp_solver{graph, create_solver(graph->G, algo, opt)};
+}
+
+int sssp_solver_run(sssp_solver *solver, uint32_t source, uint32_t *dist) {
+  if (source >= solver->graph->G.n) {
+    return -1;
+  }
+  solver->solver->reset_timer();
+  solver->solver->sssp(source, dist);
+  return 0;
+}
+
+double sssp_solver_last_time(sssp_solver *solver) {
+  return solver->solver->t_all.get_total();
+}
+
+void sssp_solver_free(sssp_solver *solver) {
+  if (solver) {
+    delete solver->solver;
+    delete solver;
+  }
+}
+
+uint32_t sssp_unreachable(void) { return INT_MAX / 2; }
@@ -0,0 +1,50 @@
+#ifndef SSSP_C_H
+#define SSSP_C_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* C ABI of libsssp. Handles are opaque, every function is reentrant for
+   distinct handles. Distances of unreachable vertices equal
+   sssp_unreachable(). */
+
+typedef struct sssp_graph sssp_graph;
+typedef struct sssp_solver sssp_solver;
+
+/* Reads a .adj, .bin, .wsg or .gr file, unweighted graphs get the same
+   random weights as the sssp driver. Exits the process on malformed input. */
+sssp_graph *sssp_graph_load(const char *path, int weighted, int symmetrized);
+/* Builds a synthetic weighted graph from a generator spec such as
+   "rmat:20:16" or "geo:1000000:8@7", see src/generators.hpp. rmat and er
+   graphs are symmetric if symmetrized is set. Exits the process on a
+   malformed spec. */
+sssp_graph *sssp_graph_generate(const char *spec, int symmetrized);
+/* Copies a CSR graph, weights may be NULL for unit weights */
+sssp_graph *sssp_graph_from_csr(uint64_t n, uint64_t m, const uint64_t *offsets,
+                                const uint32_t *targets,
+                                const uint32_t *weights, int symmetrized);
+uint64_t sssp_graph_num_vertices(const sssp_graph *graph);
+uint64_t sssp_graph_num_edges(const sssp_graph *graph);
+void sssp_graph_free(sssp_graph *graph);
+
+/* algorithm is one of the names accepted by the -a option of the driver,
+   returns NULL for unknown names. The graph must outlive the solver. */
+sssp_solver *sssp_solver_create(const sssp_graph *graph, const char *algorithm,
+                                uint64_t param);
+/* Writes n distances to dist, returns 0 on success and -1 for an invalid
+   source */
+int sssp_solver_run(sssp_solver *solver, uint32_t source, uint32_t *dist);
+/* Seconds spent in the last call of sssp_solver_run */
+double sssp_solver_last_time(sssp_solver *solver);
+void sssp_solver_free(sssp_solver *solver);
+
+uint32_t sssp_unreachable(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
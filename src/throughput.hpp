@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+
+#include "sssp.h"
+
+// Graphs up to this many vertices run one query per worker instead of one
+// parallel query at a time, their rounds are too short to keep all workers
+// busy
+constexpr size_t INTER_QUERY_MAX_N = 1 << 22;
+
+struct ThroughputResult {
+  size_t lanes;
+  size_t queries;
+  double seconds;
+  // Time of the query of every source as measured by its solver
+  std::vector<double> latency;
+};
+
+// Answers independent queries concurrently. Every lane owns a solver and a
+// distance buffer and keeps taking the next source until none is left, the
+// solvers still parallelize internally so idle workers steal from them. The
+// first lane runs the given solver, which stays owned by the caller, the
+// others run clones of it that share its per-graph preprocessing.
+class ThroughputRunner {
+ private:
+  const Graph &G;
+  std::vector<SSSPSolver *> pool;
+  std::vector<sequence<EdgeTy>> dist;
+
+ public:
+  ThroughputRunner() = delete;
+  ThroughputRunner(const Graph &_G, size_t num_sources, SSSPSolver *solver)
+      : G(_G) {
+    size_t lanes = 1;
+    if (G.n <= INTER_QUERY_MAX_N) {
+      lanes = max<size_t>(1, min<size_t>(num_workers(), num_sources));
+    }
+    pool.push_back(solver);
+    dist.push_back(sequence<EdgeTy>(G.n));
+    for (size_t i = 1; i < lanes; i++) {
+      pool.push_back(solver->clone());
+      dist.push_back(sequence<EdgeTy>(G.n));
+    }
+  }
+  ~ThroughputRunner() {
+    for (size_t i = 1; i < pool.size(); i++) {
+      delete pool[i];
+    }
+  }
+
+  size_t lanes() const { return pool.size(); }
+
+  // Calls on_result(i, dist) from the lane that answered sources[i], dist is
+  // only valid until the callback returns
+  template <class F>
+  ThroughputResult run(const std::vector<NodeId> &sources, F on_result) {
+    size_t next = 0;
+    std::vector<double> latency(sources.size());
+    timer tm;
+    parallel_for(0, pool.size(), [&](size_t l) {
+      while (true) {
+        size_t i = fetch_and_add(&next, 1);
+        if (i >= sources.size()) {
+          break;
+        }
+        pool[l]->reset_timer();
+        pool[l]->sssp(sources[i], dist[l].begin());
+        latency[i] = pool[l]->t_all.get_total();
+        on_result(i, (const EdgeTy *)dist[l].begin());
+      }
+    }, 1);
+    tm.stop();
+    return ThroughputResult{pool.size(), sources.size(), tm.get_total(),
+                            std::move(latency)};
+  }
+
+  ThroughputResult run(const std::vector<NodeId> &sources) {
+    return run(sources, [](size_t, const EdgeTy *) {});
+  }
+};
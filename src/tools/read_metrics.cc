@@ -0,0 +1,131 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+#include "../backend/columnar_format.hpp"
+
+// Prints the files written by sssp -m columnar:PATH
+int main(int argc, char *argv[])
+{
+  char mode = 0;
+  int c;
+  while ((c = getopt(argc, argv, "vsH")) != -1)
+  {
+    switch (c)
+    {
+    case 'v':
+    case 's':
+    case 'H':
+      mode = c;
+      break;
+    default:
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (optind + 1 != argc)
+  {
+    fprintf(
+        stderr,
+        "Usage: %s [-v] [-s] [-H] metrics_file\n"
+        "Without options, prints one summary line per round\n"
+        "Options:\n"
+        "\t-v,\tprint round,source,node,insertions,edge_relaxations of every node "
+        "(edge_relaxations is empty if the node was never relaxed)\n"
+        "\t-s,\tprint round,source,step,vertices of every step\n"
+        "\t-H,\tprint how many nodes were inserted k times, over all rounds\n",
+        argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  ColumnarReader reader(argv[optind]);
+  if (!reader.open())
+  {
+    fprintf(stderr, "Error: %s is not a columnar metrics file\n", argv[optind]);
+    exit(EXIT_FAILURE);
+  }
+  fprintf(stderr, "Info: %s, parameter %ld, regime %s, %lu vertices\n",
+          reader.algorithm.c_str(), reader.header.parameter,
+          reader.regime.c_str(), reader.header.n);
+
+  if (mode == 0)
+  {
+    printf("round,source,processors,sample_rate,nodes,steps,insertions,"
+           "reinserts,max_insertions,edge_relaxations\n");
+  }
+  else if (mode == 'v')
+  {
+    printf("round,source,node,insertions,edge_relaxations\n");
+  }
+  else if (mode == 's')
+  {
+    printf("round,source,step,vertices\n");
+  }
+
+  ColumnarRound round;
+  std::map<uint64_t, uint64_t> histogram;
+  size_t rounds = 0;
+  for (; reader.next(round, mode != 's'); rounds++)
+  {
+    const ColumnarRoundHeader &h = round.header;
+    if (mode == 0)
+    {
+      uint64_t insertions = 0, reinserts = 0, most = 0, relaxations = 0;
+      for (size_t i = 0; i < h.nodes; i++)
+      {
+        insertions += round.insertions[i];
+        reinserts += round.insertions[i] ? round.insertions[i] - 1 : 0;
+        most = std::max(most, round.insertions[i]);
+        relaxations += round.relaxations[i] ? round.relaxations[i] - 1 : 0;
+      }
+      // Totals are estimated from the sample like the database backends do
+      printf("%zu,%lu,%u,%u,%lu,%lu,%lu,%lu,%lu,%lu\n", rounds, h.source,
+             h.processors, h.sample_rate, h.nodes, h.steps,
+             insertions * h.sample_rate, reinserts * h.sample_rate, most,
+             relaxations * h.sample_rate);
+    }
+    else if (mode == 'v')
+    {
+      for (size_t i = 0; i < h.nodes; i++)
+      {
+        printf("%zu,%lu,%lu,%lu,", rounds, h.source, round.node[i],
+               round.insertions[i]);
+        if (round.relaxations[i])
+        {
+          printf("%lu", round.relaxations[i] - 1);
+        }
+        printf("\n");
+      }
+    }
+    else if (mode == 's')
+    {
+      for (size_t step = 0; step < h.steps; step++)
+      {
+        printf("%zu,%lu,%zu,%lu\n", rounds, h.source, step, round.steps[step]);
+      }
+    }
+    else
+    {
+      for (size_t i = 0; i < h.nodes; i++)
+      {
+        histogram[round.insertions[i]]++;
+      }
+    }
+  }
+  if (mode == 'H')
+  {
+    printf("insertions,nodes\n");
+    for (auto [k, count] : histogram)
+    {
+      printf("%lu,%lu\n", k, count);
+    }
+  }
+  fprintf(stderr, "Info: %zu rounds\n", rounds);
+  if (reader.truncated())
+  {
+    fprintf(stderr, "Warning: The file ends inside round %zu\n", rounds);
+  }
+  return 0;
+}
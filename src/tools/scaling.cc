@@ -0,0 +1,447 @@
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sqlite3.h"
+
+// Strong and weak scaling sweeps of the sssp driver. The number of workers
+// of the Cilk runtime is fixed when it starts, so every configuration runs
+// in a child process with CILK_NWORKERS set and reports back through the
+// JSON file of -j.
+struct ScalingRun
+{
+  std::string input;
+  std::string algorithm;
+  std::string param;  // empty for the default of the algorithm
+  int workers;
+  // from the JSON report
+  std::string digest;
+  long parameter;
+  double mean, p50, p99, throughput;
+  // relative to the run of the series with the fewest workers
+  double speedup, efficiency;
+};
+
+static std::vector<std::string> split(const char *list)
+{
+  std::vector<std::string> items;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ','))
+  {
+    if (!item.empty())
+    {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+// Number or string value of key, inside the object named object if given
+static std::string json_value(const std::string &json, const char *object,
+                              const char *key)
+{
+  size_t from = 0;
+  if (object)
+  {
+    from = json.find(std::string("\"") + object + "\"");
+    if (from == std::string::npos)
+    {
+      return "";
+    }
+  }
+  size_t at = json.find(std::string("\"") + key + "\":", from);
+  if (at == std::string::npos)
+  {
+    return "";
+  }
+  at = json.find(':', at) + 1;
+  while (at < json.size() && json[at] == ' ')
+  {
+    at++;
+  }
+  if (at < json.size() && json[at] == '"')
+  {
+    return json.substr(at + 1, json.find('"', at + 1) - at - 1);
+  }
+  return json.substr(at, json.find_first_of(",}", at) - at);
+}
+
+static bool run_sssp(const char *binary, const std::vector<std::string> &args,
+                     int workers, bool verbose)
+{
+  pid_t pid = fork();
+  if (pid < 0)
+  {
+    return false;
+  }
+  if (pid == 0)
+  {
+    setenv("CILK_NWORKERS", std::to_string(workers).c_str(), 1);
+    if (!verbose)
+    {
+      int null_fd = open("/dev/null", O_WRONLY);
+      dup2(null_fd, STDOUT_FILENO);
+    }
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>(binary));
+    for (auto &a : args)
+    {
+      argv.push_back(const_cast<char *>(a.c_str()));
+    }
+    argv.push_back(nullptr);
+    execv(binary, argv.data());
+    fprintf(stderr, "Error: Cannot run %s: %s\n", binary, strerror(errno));
+    _exit(127);
+  }
+  int status;
+  return waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+         WEXITSTATUS(status) == 0;
+}
+
+static void store(const char *path, const std::vector<ScalingRun> &runs,
+                  const char *regime, const char *scaling, bool throughput,
+                  int sources, int rounds)
+{
+  sqlite3 *db = nullptr;
+  if (sqlite3_open(path, &db))
+  {
+    fprintf(stderr, "Error: Could not open database %s\n", path);
+    exit(EXIT_FAILURE);
+  }
+  char *errorMsg = nullptr;
+  const char *create_scaling_sql = "CREATE TABLE IF NOT EXISTS SSSPScaling ("
+                                   "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                                   "graph_id INTEGER,"
+                                   "input TEXT,"
+                                   "digest TEXT,"
+                                   "algorithm TEXT,"
+                                   "algorithmParameter INTEGER,"
+                                   "regime TEXT,"
+                                   "scaling TEXT,"
+                                   "mode TEXT,"
+                                   "processors INTEGER,"
+                                   "sources INTEGER,"
+                                   "rounds INTEGER,"
+                                   "mean REAL,"
+                                   "p50 REAL,"
+                                   "p99 REAL,"
+                                   "throughput REAL,"
+                                   "speedup REAL,"
+                                   "efficiency REAL,"
+                                   "FOREIGN KEY(graph_id) REFERENCES Graph(id));";
+  if (sqlite3_exec(db, create_scaling_sql, nullptr, nullptr, &errorMsg) != SQLITE_OK ||
+      sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, &errorMsg) != SQLITE_OK)
+  {
+    fprintf(stderr, "SQL error: %s\n", errorMsg);
+    exit(EXIT_FAILURE);
+  }
+  // graphs that are not registered, or databases without a Graph table, get
+  // a NULL graph_id and can still be joined by digest
+  sqlite3_stmt *find_graph = nullptr;
+  sqlite3_prepare_v2(db, "SELECT id FROM Graph WHERE hash_digest=?;", -1,
+                     &find_graph, nullptr);
+  sqlite3_stmt *insert = nullptr;
+  if (sqlite3_prepare_v2(db,
+                         "INSERT INTO SSSPScaling (graph_id,input,digest,algorithm,"
+                         "algorithmParameter,regime,scaling,mode,processors,sources,"
+                         "rounds,mean,p50,p99,throughput,speedup,efficiency) VALUES "
+                         "(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)",
+                         -1, &insert, nullptr) != SQLITE_OK)
+  {
+    fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+    exit(EXIT_FAILURE);
+  }
+  for (auto &r : runs)
+  {
+    sqlite3_bind_null(insert, 1);
+    if (find_graph)
+    {
+      sqlite3_bind_text(find_graph, 1, r.digest.c_str(), -1, SQLITE_STATIC);
+      if (sqlite3_step(find_graph) == SQLITE_ROW)
+      {
+        sqlite3_bind_int(insert, 1, sqlite3_column_int(find_graph, 0));
+      }
+      sqlite3_reset(find_graph);
+    }
+    sqlite3_bind_text(insert, 2, r.input.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(insert, 3, r.digest.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(insert, 4, r.algorithm.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(insert, 5, r.parameter);
+    sqlite3_bind_text(insert, 6, regime, -1, SQLITE_STATIC);
+    sqlite3_bind_text(insert, 7, scaling, -1, SQLITE_STATIC);
+    sqlite3_bind_text(insert, 8, throughput ? "throughput" : "latency", -1,
+                      SQLITE_STATIC);
+    sqlite3_bind_int(insert, 9, r.workers);
+    sqlite3_bind_int(insert, 10, sources);
+    sqlite3_bind_int(insert, 11, rounds);
+    sqlite3_bind_double(insert, 12, r.mean);
+    sqlite3_bind_double(insert, 13, r.p50);
+    sqlite3_bind_double(insert, 14, r.p99);
+    sqlite3_bind_double(insert, 15, r.throughput);
+    sqlite3_bind_double(insert, 16, r.speedup);
+    sqlite3_bind_double(insert, 17, r.efficiency);
+    if (sqlite3_step(insert) != SQLITE_DONE)
+    {
+      fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+      exit(EXIT_FAILURE);
+    }
+    sqlite3_reset(insert);
+  }
+  sqlite3_finalize(find_graph);
+  sqlite3_finalize(insert);
+  if (sqlite3_exec(db, "END TRANSACTION;", nullptr, nullptr, &errorMsg) != SQLITE_OK)
+  {
+    fprintf(stderr, "SQL error: %s\n", errorMsg);
+    exit(EXIT_FAILURE);
+  }
+  sqlite3_close(db);
+  printf("Info: Stored %zu runs in %s\n", runs.size(), path);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc == 1)
+  {
+    fprintf(
+        stderr,
+        "Usage: %s -i inputs [-a algorithms] [-p parameters] [-P workers] "
+        "[-k] [-m sqlite:PATH] [sssp options]\n"
+        "Runs every input, algorithm and parameter with every worker count "
+        "and reports the speedup and parallel efficiency over the run with "
+        "the fewest workers. Lists are comma separated.\n"
+        "Options:\n"
+        "\t-i,\tinput files or gen: specs of the sssp driver\n"
+        "\t-a,\talgorithms (default rho-stepping,delta-stepping,bellman-ford)\n"
+        "\t-p,\tparameters (default: the default of each algorithm)\n"
+        "\t-P,\tworker counts (default 1, 2, 4, ... and all cores)\n"
+        "\t-k,\tweak scaling: the i-th input only runs with the i-th worker "
+        "count, efficiency is then T(fewest workers) / T(p)\n"
+        "\t-m,\tstore the runs in the SSSPScaling table of sqlite:PATH\n"
+        "\t-x,\tpath of the sssp driver (default ./sssp)\n"
+        "\t-v,\tshow the output of the driver\n"
+        "\t-n, -r, -w, -s, -t, -g:\tpassed to the driver\n",
+        argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  const char *BINARY = "./sssp";
+  std::vector<std::string> inputs;
+  std::vector<std::string> algorithms = {"rho-stepping", "delta-stepping",
+                                         "bellman-ford"};
+  std::vector<std::string> params = {""};
+  std::vector<int> workers;
+  bool weak = false;
+  bool verbose = false;
+  bool throughput = false;
+  std::string METRICS_PATH = "";
+  const char *REGIME = "unspecified";
+  int NUM_SOURCES = 10;
+  int NUM_ROUNDS = 10;
+  std::vector<std::string> pass;
+  int c;
+  while ((c = getopt(argc, argv, "i:a:p:P:km:x:vn:r:wstg:")) != -1)
+  {
+    switch (c)
+    {
+    case 'i':
+      inputs = split(optarg);
+      break;
+    case 'a':
+      algorithms = split(optarg);
+      break;
+    case 'p':
+      params = split(optarg);
+      break;
+    case 'P':
+      for (auto &w : split(optarg))
+      {
+        workers.push_back(atoi(w.c_str()));
+      }
+      break;
+    case 'k':
+      weak = true;
+      break;
+    case 'm':
+      METRICS_PATH = optarg;
+      break;
+    case 'x':
+      BINARY = optarg;
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    case 'n':
+      NUM_SOURCES = atoi(optarg);
+      break;
+    case 'r':
+      NUM_ROUNDS = atoi(optarg);
+      break;
+    case 'g':
+      REGIME = optarg;
+      pass.push_back("-g");
+      pass.push_back(optarg);
+      break;
+    case 't':
+      throughput = true;
+      pass.push_back("-t");
+      break;
+    case 'w':
+    case 's':
+      pass.push_back(std::string("-") + (char)c);
+      break;
+    default:
+      fprintf(stderr, "Error: Unknown option %c\n", optopt);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (workers.empty())
+  {
+    int cores = std::max(1u, std::thread::hardware_concurrency());
+    for (int p = 1; p < cores; p *= 2)
+    {
+      workers.push_back(p);
+    }
+    workers.push_back(cores);
+  }
+  if (inputs.empty() || (weak && inputs.size() != workers.size()))
+  {
+    fprintf(stderr, "Error: %s\n",
+            inputs.empty() ? "No input given"
+                           : "Weak scaling needs one input per worker count");
+    exit(EXIT_FAILURE);
+  }
+  // the first run of a series is the base of its speedup, so every series
+  // runs from the fewest workers up; weak scaling keeps the inputs paired
+  if (weak)
+  {
+    std::vector<std::pair<int, std::string>> paired;
+    for (size_t w = 0; w < workers.size(); w++)
+    {
+      paired.emplace_back(workers[w], inputs[w]);
+    }
+    std::stable_sort(paired.begin(), paired.end(),
+                     [](const std::pair<int, std::string> &a,
+                        const std::pair<int, std::string> &b)
+                     { return a.first < b.first; });
+    for (size_t w = 0; w < paired.size(); w++)
+    {
+      workers[w] = paired[w].first;
+      inputs[w] = paired[w].second;
+    }
+  }
+  else
+  {
+    std::sort(workers.begin(), workers.end());
+    workers.erase(std::unique(workers.begin(), workers.end()), workers.end());
+  }
+  if (METRICS_PATH != "" && METRICS_PATH.rfind("sqlite:", 0) != 0)
+  {
+    fprintf(stderr, "Error: Only sqlite:PATH is supported for the results\n");
+    exit(EXIT_FAILURE);
+  }
+  char json_path[] = "/tmp/sssp_scaling_XXXXXX";
+  int json_fd = mkstemp(json_path);
+  if (json_fd < 0)
+  {
+    fprintf(stderr, "Error: Cannot create a temporary file\n");
+    exit(EXIT_FAILURE);
+  }
+  close(json_fd);
+
+  // one series per input (strong) or for all inputs (weak) and per
+  // algorithm and parameter, ordered by worker count
+  std::vector<std::vector<ScalingRun>> series;
+  size_t num_series = weak ? 1 : inputs.size();
+  for (size_t g = 0; g < num_series; g++)
+  {
+    for (auto &algorithm : algorithms)
+    {
+      for (auto &param : params)
+      {
+        series.emplace_back();
+        for (size_t w = 0; w < workers.size(); w++)
+        {
+          ScalingRun r;
+          r.input = weak ? inputs[w] : inputs[g];
+          r.algorithm = algorithm;
+          r.param = param;
+          r.workers = workers[w];
+          series.back().push_back(r);
+        }
+      }
+    }
+  }
+
+  printf("%-24s %-22s %10s %7s %12s %12s %12s %12s %8s %10s\n", "input",
+         "algorithm", "parameter", "workers", "mean_s", "p50_s", "p99_s",
+         "queries/s", "speedup", "efficiency");
+  fflush(stdout);
+  std::vector<ScalingRun> done;
+  for (auto &s : series)
+  {
+    const ScalingRun *base = nullptr;
+    for (auto &r : s)
+    {
+      std::vector<std::string> args = {"-i", r.input, "-a", r.algorithm,
+                                       "-n", std::to_string(NUM_SOURCES),
+                                       "-r", std::to_string(NUM_ROUNDS),
+                                       "-j", json_path};
+      if (!r.param.empty())
+      {
+        args.push_back("-p");
+        args.push_back(r.param);
+      }
+      args.insert(args.end(), pass.begin(), pass.end());
+      truncate(json_path, 0);
+      if (!run_sssp(BINARY, args, r.workers, verbose))
+      {
+        fprintf(stderr, "Warning: %s failed on %s with %d workers\n",
+                r.algorithm.c_str(), r.input.c_str(), r.workers);
+        continue;
+      }
+      std::ifstream ifs(json_path);
+      std::string json((std::istreambuf_iterator<char>(ifs)),
+                       std::istreambuf_iterator<char>());
+      r.digest = json_value(json, nullptr, "digest");
+      r.parameter = atol(json_value(json, nullptr, "parameter").c_str());
+      r.throughput = atof(json_value(json, nullptr, "throughput_qps").c_str());
+      r.mean = atof(json_value(json, "measured", "mean_s").c_str());
+      r.p50 = atof(json_value(json, "measured", "p50_s").c_str());
+      r.p99 = atof(json_value(json, "measured", "p99_s").c_str());
+      if (!base)
+      {
+        base = &r;
+      }
+      // throughput is queries per second in both modes, so its ratio is
+      // the speedup; with weak scaling the work grows with the workers
+      double ratio = base->throughput > 0 ? r.throughput / base->throughput : 0;
+      double scale = (double)r.workers / base->workers;
+      r.speedup = weak ? ratio * scale : ratio;
+      r.efficiency = weak ? ratio : ratio / scale;
+      printf("%-24s %-22s %10ld %7d %12.6f %12.6f %12.6f %12.2f %8.2f %10.2f\n",
+             r.input.c_str(), r.algorithm.c_str(), r.parameter, r.workers,
+             r.mean, r.p50, r.p99, r.throughput, r.speedup, r.efficiency);
+      fflush(stdout);
+      done.push_back(r);
+    }
+  }
+  unlink(json_path);
+
+  if (METRICS_PATH != "")
+  {
+    store(METRICS_PATH.substr(strlen("sqlite:")).c_str(), done, REGIME,
+          weak ? "weak" : "strong", throughput, NUM_SOURCES, NUM_ROUNDS);
+  }
+  return 0;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+constexpr size_t TRACE_CAPACITY = 1 << 18;
+
+enum TracePhase { trace_sampling = 0, trace_relax, trace_pack };
+
+// One phase of a round. frontier is the input size for sampling and relax
+// and the size of the next frontier for pack. threshold and subrounds belong
+// to the latest relax, the cost model fields to the decision in effect after
+// the phase.
+struct TraceEvent {
+  uint32_t query;
+  uint32_t round;
+  TracePhase phase;
+  double start;  // seconds since the tracer was created
+  double duration;
+  uint64_t frontier;
+  uint64_t threshold;
+  uint64_t est_edges;
+  uint64_t sparse_cost;
+  uint64_t dense_cost;
+  bool sparse;
+  uint32_t subrounds;
+};
+
+// Fixed-size ring of the latest events. Recording only copies the event,
+// the exports are written after the queries; events are recorded from
+// serial code between the parallel phases, so there is no synchronization.
+class Tracer {
+ private:
+  using Clock = std::chrono::steady_clock;
+  std::vector<TraceEvent> ring;
+  size_t count;
+  uint32_t queries;
+  Clock::time_point epoch;
+
+  static const char *phase_name(TracePhase p) {
+    static const char *names[] = {"sampling", "relax", "pack"};
+    return names[p];
+  }
+
+  template <class F>
+  void for_each(F f) const {
+    size_t first = count > ring.size() ? count - ring.size() : 0;
+    for (size_t i = first; i < count; i++) {
+      f(ring[i % ring.size()]);
+    }
+  }
+
+ public:
+  explicit Tracer(size_t capacity = TRACE_CAPACITY)
+      : ring(capacity), count(0), queries(0), epoch(Clock::now()) {}
+
+  double now() const {
+    return std::chrono::duration<double>(Clock::now() - epoch).count();
+  }
+  // Returns the id of the new query
+  uint32_t begin_query() { return queries++; }
+  void record(const TraceEvent &e) { ring[count++ % ring.size()] = e; }
+  size_t size() const { return std::min(count, ring.size()); }
+  size_t dropped() const { return count - size(); }
+
+  bool write_csv(const std::string &path) const {
+    FILE *f = fopen(path.c_str(), "w");
+    if (!f) {
+      return false;
+    }
+    fprintf(f, "query,round,phase,start_us,duration_us,frontier,threshold,"
+               "est_edges,sparse_cost,dense_cost,sparse,subrounds\n");
+    for_each([&](const TraceEvent &e) {
+      fprintf(f, "%u,%u,%s,%.3f,%.3f,%lu,%lu,%lu,%lu,%lu,%d,%u\n", e.query,
+              e.round, phase_name(e.phase), e.start * 1e6, e.duration * 1e6,
+              e.frontier, e.threshold, e.est_edges, e.sparse_cost,
+              e.dense_cost, e.sparse, e.subrounds);
+    });
+    return fclose(f) == 0;
+  }
+
+  // Complete ("X") events of the Chrome trace event format, one track per
+  // query, loadable in chrome://tracing and Perfetto
+  bool write_chrome(const std::string &path) const {
+    FILE *f = fopen(path.c_str(), "w");
+    if (!f) {
+      return false;
+    }
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first = true;
+    for_each([&](const TraceEvent &e) {
+      fprintf(f,
+              "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,"
+              "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"round\":%u,"
+              "\"frontier\":%lu,\"threshold\":%lu,\"est_edges\":%lu,"
+              "\"sparse_cost\":%lu,\"dense_cost\":%lu,\"mode\":\"%s\","
+              "\"subrounds\":%u}}",
+              first ? "" : ",", phase_name(e.phase), e.query, e.start * 1e6,
+              e.duration * 1e6, e.round, e.frontier, e.threshold, e.est_edges,
+              e.sparse_cost, e.dense_cost, e.sparse ? "sparse" : "dense",
+              e.subrounds);
+      first = false;
+    });
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0;
+  }
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// LEB128 varints, 7 bits per byte with the high bit set on all but the last
+inline void put_varint(std::string &out, uint64_t x) {
+  while (x >= 0x80) {
+    out.push_back((char)(x | 0x80));
+    x >>= 7;
+  }
+  out.push_back((char)x);
+}
+
+inline uint64_t get_varint(const unsigned char *&p) {
+  uint64_t x = 0;
+  for (int shift = 0;; shift += 7) {
+    x |= (uint64_t)(*p & 0x7f) << shift;
+    if (!(*p++ & 0x80)) {
+      return x;
+    }
+  }
+}